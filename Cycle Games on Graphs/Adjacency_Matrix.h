@@ -7,7 +7,9 @@
  *
  */
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -15,9 +17,21 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // !_WIN32
+
 #include "Misc.h"
 
 /*
@@ -36,262 +50,529 @@
 // many elements we'll read in
 #define MAX_ELEMENTS 500 // arbitrary max value, feel free to increase if needed
 
-// Used within Cycle_Games.h, but made sense categorically to #define these in
-// here
-// typedef uint_fast16_t Adjacency_Info;
-// #define ADJACENT		1
-// #define NOT_ADJACENT	0
-enum class Adjacency_Info : uint_fast16_t { ADJACENT, NOT_ADJACENT };
+// Below these sizes, splitting up the work of loading a graph costs more in
+// thread start up than it saves, so each thread gets at least this much to do
+#define ADJ_PARALLEL_MIN_BYTES ((size_t)1 << 22) // of listing text to parse
+#define ADJ_PARALLEL_MIN_ENTRIES ((size_t)1 << 19) // of entries to sort
+
+// Graphs with up to ADJ_NARROW_MAX_NODES nodes get 16 bit node labels, bigger
+// ones get 32 bit labels. The largest label of each width is never handed out,
+// since the code uses it to mean "no node"
+#define ADJ_NARROW_MAX_NODES UINT16_MAX
+#define ADJ_WIDE_MAX_NODES UINT32_MAX
+// offsets/ edge IDs are 32 bit, and every edge takes up 2 spots in neighbors
+#define ADJ_MAX_EDGES (UINT32_MAX / 2)
+
+/*
+ *
+ * - The game playing code used to take in a num_nodes * num_nodes adjacency
+ * matrix, which meant every ply of the search scanned every column of a row
+ * just to find the handful of actual neighbors
+ * - Instead we now hold the graph in compressed sparse row (CSR) form:
+ *	- the neighbors of node i are neighbors[offsets[i]] through
+ *	neighbors[offsets[i + 1] - 1], listed in ascending order so the games still
+ *	try moves in the same order they always have
+ *	- each undirected edge gets a single ID, and edge_ids[j] holds the ID of the
+ *	edge leading to neighbors[j]. Both "directions" of an edge share the ID, so
+ *	marking an edge as used is a single write
+ * - Duplicate entries in an adjacency listing (e.g. GP(n, n/2)'s inner ring)
+ * collapse to a single edge, same as they did in the old matrix
+ * - The arrays are only pointed to, so they can live either in vectors built
+ * from a text listing or straight in a mapped graph file (see Graph_File.h).
+ * storage keeps whichever it is alive for as long as any copy of the graph is
+ * around
+ * - NODE_T is the type node labels are stored as. Every graph that fits gets
+ * 16 bit labels (ADJACENCY_CSR), which is what all of the games are played
+ * on. Graphs with more than ADJ_NARROW_MAX_NODES nodes get 32 bit labels
+ * instead (WIDE_ADJACENCY_CSR), and the loaders pick whichever one fits
+ *
+ */
+template <typename NODE_T> struct ADJACENCY_CSR_T {
+    static_assert(std::is_same_v<NODE_T, uint16_t> ||
+                      std::is_same_v<NODE_T, uint32_t>,
+                  "Node labels are either 16 or 32 bits!");
+
+    uint_fast32_t num_nodes = 0;
+    uint_fast32_t num_edges = 0;
+    const uint32_t *offsets = NULL; // num_nodes + 1 entries
+    const NODE_T *neighbors = NULL; // 2 * num_edges entries (minus self loops)
+    const uint32_t *edge_ids = NULL; // parallel to neighbors
+    std::shared_ptr<const void> storage;
+};
+typedef ADJACENCY_CSR_T<uint16_t> ADJACENCY_CSR;
+typedef ADJACENCY_CSR_T<uint32_t> WIDE_ADJACENCY_CSR;
+// A loaded graph, of whichever width fit it
+typedef std::variant<ADJACENCY_CSR, WIDE_ADJACENCY_CSR> ANY_ADJACENCY_CSR;
+
+// The arrays of a graph built in memory, for ADJACENCY_CSR_T::storage
+template <typename NODE_T> struct CSR_ARRAYS {
+    std::vector<uint32_t> offsets;
+    std::vector<NODE_T> neighbors;
+    std::vector<uint32_t> edge_ids;
+};
+
+// a single "node_1,node_2" entry read in from an adjacency listing. Entries
+// always hold 32 bit labels, since how many nodes the graph has (and so which
+// width it gets) isn't known until they've all been read
+typedef std::pair<uint32_t, uint32_t> ADJ_LIST_ENTRY;
+
+/****************************************************************************
+ * graph_num_nodes
+ *
+ * - Lil helper function, gets the number of nodes in a loaded graph of either
+ * width
+ ****************************************************************************/
+inline uint_fast32_t
+graph_num_nodes(const ANY_ADJACENCY_CSR &__restrict graph) {
+    return std::visit([](const auto &csr) { return csr.num_nodes; }, graph);
+}
+
+/****************************************************************************
+ * adj_load_threads
+ *
+ * - Works out how many threads to split a piece of graph loading work across,
+ * giving each at least min_per_thread of it and using no more threads than
+ * the machine has cores
+ *
+ * Parameters :
+ * - work : how much work there is (bytes, entries, etc.)
+ * - min_per_thread : the least amount of work worth starting a thread for
+ *
+ * Returns :
+ * - size_t : the number of threads to use, at least 1
+ ****************************************************************************/
+inline size_t adj_load_threads(const size_t work, const size_t min_per_thread) {
+    const size_t num_cores =
+        std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    return std::clamp<size_t>(work / min_per_thread, 1, num_cores);
+}
+
+/****************************************************************************
+ * run_adj_load_threads
+ *
+ * - Runs job(0) through job(num_threads - 1) at the same time, one per thread,
+ * and waits for all of them to finish. job(0) runs on the calling thread, so
+ * a single job starts up no threads at all
+ ****************************************************************************/
+template <typename JOB>
+void run_adj_load_threads(const size_t num_threads, JOB &&job) {
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back([&job, i]() { job(i); });
+    }
+    job(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
 
 /****************************************************************************
- * dos2unix_repair
+ * build_adjacency_csr
  *
- * - Opens the specified file containing an adjacency listing, then creates a
- * copy of it without carriage returns ('\r') so the non-Windows world can use
- * the file
- * - Takes the existing file name and appends "_repaired" to it for the copy's
- *name
- * - Shamelessly taken from
- *https://stackoverflow.com/questions/58279627/reimplementing-dos2unix-and-unix2dos-in-c-r-and-n-not-appearing-in-hexd
+ * - Takes in the raw entries read in from an adjacency listing and builds
+ * the CSR form of the graph from them
+ * - Each entry is first put in (smaller label, larger label) order, then the
+ * entries are sorted with two stable counting sort passes (larger label
+ * first, then smaller label) so duplicates end up next to eachother and can be
+ * dropped. Edge IDs are handed out in that sorted order
+ * - For big listings the counting sort passes are split across threads. The
+ * passes are still stable, so the graph comes out the same down to the byte
+ * - Because the edges are visited in sorted order when the rows are filled,
+ * every row comes out in ascending order without any further sorting
  *
  * Parameters :
- * - file_path : std::filesystem::path object holding the path for the desired
- *file
+ * - entries : the entries read in from the adjacency listing. The contents are
+ * reordered by the call
+ * - num_nodes : the number of nodes in the graph (largest label + 1), which
+ * has to fit NODE_T (see ADJ_NARROW_MAX_NODES)
  *
  * Returns :
- * - std::filesystem::path : path to the repaired copy of the file
+ * - ADJACENCY_CSR_T<NODE_T> : the graph in CSR form
  ****************************************************************************/
-std::filesystem::path dos2unix_repair(const std::filesystem::path file_path) {
-    char c;
-    std::ifstream is(file_path.c_str());
-
-    std::filesystem::path repair_file_path = file_path;
-    repair_file_path.replace_extension("");
-    repair_file_path.replace_filename(repair_file_path.filename().string() +
-                                      "_repaired");
-    repair_file_path.replace_extension(".txt");
-    std::ofstream os(repair_file_path.c_str());
-
-    while (is.get(c)) {
-        if (c != '\r') [[likely]] {
-            os.put(c);
+template <typename NODE_T>
+ADJACENCY_CSR_T<NODE_T>
+build_adjacency_csr(std::vector<ADJ_LIST_ENTRY> &entries,
+                    const uint_fast32_t num_nodes) {
+    ADJACENCY_CSR_T<NODE_T> graph;
+    graph.num_nodes = num_nodes;
+
+    // LSD radix sort on (first, second) using counting sorts keyed on labels.
+    // Each thread counts up the labels in its own slice of the entries, and
+    // then scatters that slice to the spots the counts give it, in order, so
+    // the passes stay stable and the result doesn't depend on how many
+    // threads there were. Entries are put in (smaller, larger) order as
+    // they're counted for the first pass
+    const size_t num_entries = entries.size();
+    const size_t num_threads =
+        adj_load_threads(num_entries, ADJ_PARALLEL_MIN_ENTRIES);
+    std::vector<ADJ_LIST_ENTRY> sorted(num_entries);
+    std::vector<uint32_t> counts(num_threads * num_nodes);
+    for (const bool by_first : {false, true}) {
+        run_adj_load_threads(num_threads, [&](const size_t thread) {
+            uint32_t *const thread_counts = &counts[thread * num_nodes];
+            std::fill(thread_counts, thread_counts + num_nodes, 0);
+            const size_t slice_end = num_entries * (thread + 1) / num_threads;
+            for (size_t i = num_entries * thread / num_threads; i < slice_end;
+                 i++) {
+                ADJ_LIST_ENTRY &entry = entries[i];
+                if (!by_first && entry.first > entry.second) {
+                    std::swap(entry.first, entry.second);
+                }
+                thread_counts[by_first ? entry.first : entry.second]++;
+            }
+        });
+        // each thread's first spot for a label comes after every smaller
+        // label, and after the earlier threads' entries with the same label
+        uint32_t next_spot = 0;
+        for (uint_fast32_t label = 0; label < num_nodes; label++) {
+            for (size_t thread = 0; thread < num_threads; thread++) {
+                const uint32_t count = counts[thread * num_nodes + label];
+                counts[thread * num_nodes + label] = next_spot;
+                next_spot += count;
+            }
+        }
+        run_adj_load_threads(num_threads, [&](const size_t thread) {
+            uint32_t *const thread_counts = &counts[thread * num_nodes];
+            const size_t slice_end = num_entries * (thread + 1) / num_threads;
+            for (size_t i = num_entries * thread / num_threads; i < slice_end;
+                 i++) {
+                const ADJ_LIST_ENTRY entry = entries[i];
+                sorted[thread_counts[by_first ? entry.first
+                                              : entry.second]++] = entry;
+            }
+        });
+        entries.swap(sorted);
+    }
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    graph.num_edges = entries.size();
+
+    // count up each node's degree, then turn the counts into row offsets
+    auto arrays = std::make_shared<CSR_ARRAYS<NODE_T>>();
+    std::vector<uint32_t> &offsets = arrays->offsets;
+    offsets.assign((size_t)num_nodes + 1, 0);
+    for (const ADJ_LIST_ENTRY &entry : entries) {
+        offsets[entry.first + 1]++;
+        if (entry.first != entry.second) { // self loops only get one entry
+            offsets[entry.second + 1]++;
+        }
+    }
+    for (uint_fast32_t i = 0; i < num_nodes; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    arrays->neighbors.resize(offsets[num_nodes]);
+    arrays->edge_ids.resize(offsets[num_nodes]);
+    std::vector<uint32_t> row_fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t edge_id = 0; edge_id < (uint32_t)entries.size(); edge_id++) {
+        const NODE_T node_1 = (NODE_T)entries[edge_id].first;
+        const NODE_T node_2 = (NODE_T)entries[edge_id].second;
+        arrays->neighbors[row_fill[node_1]] = node_2;
+        arrays->edge_ids[row_fill[node_1]++] = edge_id;
+        if (node_1 != node_2) {
+            arrays->neighbors[row_fill[node_2]] = node_1;
+            arrays->edge_ids[row_fill[node_2]++] = edge_id;
         }
     }
 
-    is.close();
-    os.close();
-    return repair_file_path;
+    graph.offsets = arrays->offsets.data();
+    graph.neighbors = arrays->neighbors.data();
+    graph.edge_ids = arrays->edge_ids.data();
+    graph.storage = std::move(arrays);
+    return graph;
+}
+
+/****************************************************************************
+ * build_any_adjacency_csr
+ *
+ * - Builds the CSR form of a graph (see build_adjacency_csr) with the
+ * narrowest node labels that fit it
+ *
+ * Parameters :
+ * - entries : the graph's entries, which have to fit in the CSR arrays (at
+ * most ADJ_MAX_EDGES of them). The contents are reordered by the call
+ * - num_nodes : the number of nodes in the graph (largest label + 1)
+ *
+ * Returns :
+ * - ANY_ADJACENCY_CSR : the graph in CSR form
+ ****************************************************************************/
+ANY_ADJACENCY_CSR
+build_any_adjacency_csr(std::vector<ADJ_LIST_ENTRY> &entries,
+                        const uint_fast32_t num_nodes) {
+    if (num_nodes <= ADJ_NARROW_MAX_NODES) [[likely]] {
+        return build_adjacency_csr<uint16_t>(entries, num_nodes);
+    }
+    return build_adjacency_csr<uint32_t>(entries, num_nodes);
+}
+
+// A file mapped into memory (or read in, where there's no mmap), unmapped
+// when it goes away
+typedef struct MAPPED_FILE {
+    const char *data = NULL;
+    size_t size = 0;
+    void *mapping = NULL;
+    std::vector<uint64_t> owned; // the file's contents, where there's no mmap
+    MAPPED_FILE() = default;
+    MAPPED_FILE(const MAPPED_FILE &) = delete;
+    MAPPED_FILE &operator=(const MAPPED_FILE &) = delete;
+    ~MAPPED_FILE() {
+#if !defined(_WIN32)
+        if (mapping != NULL) {
+            munmap(mapping, size);
+        }
+#endif // !_WIN32
+    }
+} MAPPED_FILE;
+
+/****************************************************************************
+ * map_file
+ *
+ * - Maps a whole file into memory read only (or reads it in, where there's no
+ * mmap)
+ * - Pages only get read in from disk as they're touched, and there's no copy
+ * out of the page cache
+ *
+ * Parameters :
+ * - file_path : the file
+ * - file : where the mapping goes, should be freshly constructed
+ *
+ * Returns :
+ * - bool : false if the file couldn't be opened or is empty
+ ****************************************************************************/
+bool map_file(const std::filesystem::path &__restrict file_path,
+              MAPPED_FILE *__restrict file) {
+#if defined(_WIN32)
+    std::ifstream input(file_path, std::ios::binary | std::ios::ate);
+    if (!input) {
+        return false;
+    }
+    file->size = (size_t)input.tellg();
+    file->owned.resize((file->size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    input.seekg(0);
+    input.read((char *)file->owned.data(), (std::streamsize)file->size);
+    if (!input || file->size == 0) {
+        return false;
+    }
+    file->data = (const char *)file->owned.data();
+#else
+    const int fd = open(file_path.string().c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void *mapping =
+        mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    file->mapping = mapping;
+    file->size = (size_t)info.st_size;
+    file->data = (const char *)mapping;
+#endif // _WIN32
+    return true;
+}
+
+/****************************************************************************
+ * is_adj_separator
+ *
+ * - Lil helper function, checks for a character that separates entries in an
+ * adjacency listing: ADJ_FILE_DELIM, or a line ending from an older file
+ * ('\n', or the '\r' in front of it in files from Windows machines)
+ ****************************************************************************/
+inline bool is_adj_separator(const char c) {
+    return c == ADJ_FILE_DELIM || c == '\n' || c == '\r';
+}
+
+/****************************************************************************
+ * parse_adj_entries
+ *
+ * - Reads the "node_1,node_2" entries in a block of an adjacency listing,
+ * appending them to entries_out and keeping track of the largest label seen
+ * - Any run of separators (see is_adj_separator) can come before, between, or
+ * after the entries, so Windows line endings need no special treatment
+ *
+ * Parameters :
+ * - begin, end : the block to read, which shouldn't start or end partway
+ * through an entry
+ * - entries_out : where the entries go
+ * - max_label_out : raised to the largest label seen
+ *
+ * Returns :
+ * - const char * : NULL if the whole block was read, otherwise where the
+ * first malformed entry starts
+ ****************************************************************************/
+const char *parse_adj_entries(const char *begin, const char *const end,
+                              std::vector<ADJ_LIST_ENTRY> *__restrict
+                                  entries_out,
+                              uint_fast32_t *__restrict max_label_out) {
+    const char *curr = begin;
+    uint_fast32_t max_label = *max_label_out;
+    while (true) {
+        while (curr < end && is_adj_separator(*curr)) {
+            curr++;
+        }
+        if (curr == end) {
+            break;
+        }
+        const char *const entry_start = curr;
+        uint32_t node_1, node_2;
+        const auto first = std::from_chars(curr, end, node_1);
+        if (first.ec != std::errc() || first.ptr == end || *first.ptr != ',')
+            [[unlikely]] {
+            return entry_start;
+        }
+        const auto second = std::from_chars(first.ptr + 1, end, node_2);
+        if (second.ec != std::errc() ||
+            (second.ptr != end && !is_adj_separator(*second.ptr)) ||
+            std::max(node_1, node_2) >= ADJ_WIDE_MAX_NODES) [[unlikely]] {
+            return entry_start;
+        }
+        max_label = std::max<uint_fast32_t>(max_label,
+                                            std::max(node_1, node_2));
+        entries_out->emplace_back(node_1, node_2);
+        curr = second.ptr;
+    }
+    *max_label_out = max_label;
+    return NULL;
 }
 
 /****************************************************************************
  * load_adjacency_info
  *
- * - Opens the specified file containing an adjacency listing, then allocates
- * the space for and fills a buffer for the adjacency matrix corresponding to
- * the listing in the file
- * - While it would be more straightforward to repeatedly call std::getline as
- * opposed to reading in the entire block all at once, having one large read
- * from the disk should be faster than a bunch of smaller reads
+ * - Maps the specified file containing an adjacency listing into memory,
+ * reads in all of its entries in a single pass straight out of the mapping,
+ * and then builds the CSR form of the graph from them (see
+ * build_adjacency_csr)
+ * - Big files are split up at separators and read in on all cores at once,
+ * with the same result as reading them in on one
+ * - The number of nodes is worked out along the way from the largest label
+ * seen, and files with Windows line endings are read as is
+ * - Graphs with more than ADJ_NARROW_MAX_NODES nodes come back with 32 bit
+ * node labels, everything else with 16 bit ones. Labels too big for either
+ * are reported as malformed entries, instead of wrapping around
  *
  * Parameters :
  * - file_path : string holding the path to the desired file
- * - num_nodes_out : passed in by reference in order to tell the caller how
- * many nodes the given graph has
- * - success_out : pointer to a bool indicating whether an adjacency matrix was
- * successfully generated to the caller
- * - try_repair : bool indicating whether the function should try creating a
- * "repaired" version of the adjacency info file if certain error conditions are
- * met. Default value is true, but should be set to false for subsequent calls
- *to prevent infinite recursion
+ * - success_out : pointer to a bool indicating whether the graph was
+ * successfully loaded to the caller
  *
  * Returns :
- * - uint_fast16_t* : pointer to a buffer of size
- * (*num_nodes_out) * (*num_nodes_out) holding the adjacency matrix
+ * - ANY_ADJACENCY_CSR : the loaded graph. Its num_nodes holds the number of
+ * nodes the given graph has
  ****************************************************************************/
 // Need to add ability to read in adjacency matrices?
-std::vector<Adjacency_Info>
-load_adjacency_info(const std::filesystem::path file_path,
-                    uint_fast16_t *__restrict num_nodes_out,
-                    bool *__restrict success_out, bool try_repair = true) {
+ANY_ADJACENCY_CSR load_adjacency_info(const std::filesystem::path file_path,
+                                      bool *__restrict success_out) {
     *success_out = false;
-    std::vector<Adjacency_Info> adj_matrix;
-    std::fstream data_stream;
+    ANY_ADJACENCY_CSR graph;
 
-    data_stream.open(file_path.string().c_str(),
-                     std::fstream::in); // open file with read permissions only
-    if (!data_stream.is_open()) [[unlikely]] {
+    MAPPED_FILE file;
+    if (!map_file(file_path, &file)) [[unlikely]] {
         DISPLAY_ERR(true,
-                    "Failed to open the adjacency information file.\nRequested "
-                    "path: %s",
+                    "Failed to open the adjacency information file, or it's "
+                    "empty.\nRequested path: %s",
                     file_path.string().c_str());
+        return graph;
     }
-
-    size_t file_length = get_file_length(&data_stream);
-
-    // allocate a buffer with the length to read all of the file's contents in
-    // at once
-    if (!(file_length > 0)) [[unlikely]] {
-        DISPLAY_ERR(true,
-                    "Received an invalid file length.\nRequested path: %s",
-                    file_path.string().c_str());
-        return adj_matrix;
-    }
-
-    std::vector<char> data(file_length);
-    data_stream.read(data.data(), file_length);
-    data_stream.close();
-
-    // Need to find the largest node number in the data so that we can allocate
-    // the buffer for the adjacency matrix
-    uint_fast16_t temp_label;
-    uint_fast16_t max_label = 0;
-
-    // BUGBUG will need to tweak here if we use the new delimiter after the
-    // adjacency heading ?
-    size_t data_start = 0;
-    while (data_start < file_length &&
-           data[data_start] != '\n') { // skip over the labels in the first line
-        data_start++;
-    }
-    if (data_start > 0) {
-        data_start++; // increment one more time to get past that first newline
-                      // character
-    } else [[unlikely]] { // otherwise there was no file heading, indicating
-                          // some sort of error with the file/ how we read it,
-                          // return an error
+    const char *const end = file.data + file.size;
+
+    // skip over the label in the first line
+    const char *data_start =
+        std::find_if(file.data, end, [](const char c) {
+            return c == '\n' || c == '\r';
+        });
+    if (data_start == file.data || data_start == end) [[unlikely]] {
+        // there was no file heading (or nothing after it), indicating some
+        // sort of error with the file/ how we read it, return an error
         DISPLAY_ERR(true,
                     "File parsing error. Adjacency type header not found. File "
                     "path: %s",
                     file_path.string().c_str());
-        return adj_matrix;
+        return graph;
     }
 
-    size_t curr = data_start;
-
-    if (!(curr < file_length)) [[unlikely]] {
-        DISPLAY_ERR(true,
-                    "File parsing error. End of file read into memory "
-                    "unexpectedly reached. File path: %s",
-                    file_path.string().c_str());
-        return adj_matrix;
-    }
-
-    // loop to find the max label in the adjacency listing file
-    while (curr < file_length) {
-        if (std::isdigit(data[curr])) [[likely]] {
-            temp_label = std::atoi(&data[curr]);
-            max_label = std::max(temp_label, max_label);
-            curr += num_digits(temp_label) +
-                    1; // advance to the next character, and then one more to
-                       // skip a comma/ newline character
-            continue;  // back to the top of the loop
-        } else [[unlikely]] { // something went wrong
-            if (try_repair == true) [[likely]] {
-                DISPLAY_ERR(false, "Error parsing the file searching for the "
-                                   "largest node label...Attempting to create "
-                                   "a compatible version of the file now.");
-                std::filesystem::path repaired_path =
-                    dos2unix_repair(file_path); // if it's a line ending issue,
-                                                // we can try to fix it
-                adj_matrix =
-                    load_adjacency_info(repaired_path, num_nodes_out,
-                                        success_out, try_repair = false);
-            } else [[unlikely]] {
-                DISPLAY_ERR(
-                    true,
-                    "Error parsing the file searching for the largest node "
-                    "label...Non-recoverable. Try regenerating the file.");
-            }
-            return adj_matrix;
+    // Big listings get split into one block per thread. Blocks only end at
+    // separators so no entry gets split, and since each thread reads its
+    // block into its own list of entries, putting the lists back together in
+    // block order gives exactly what reading the file in one go would have
+    const size_t num_blocks =
+        adj_load_threads((size_t)(end - data_start), ADJ_PARALLEL_MIN_BYTES);
+    std::vector<const char *> block_bounds(num_blocks + 1, end);
+    block_bounds[0] = data_start;
+    for (size_t i = 1; i < num_blocks; i++) {
+        const char *bound = std::max(
+            data_start + (size_t)(end - data_start) * i / num_blocks,
+            block_bounds[i - 1]);
+        while (bound < end && !is_adj_separator(*bound)) {
+            bound++;
         }
+        block_bounds[i] = bound;
     }
 
-    max_label++; // have to account for 0 based counting with the node labels
-    *num_nodes_out = max_label;
-
-    // now that we have the max label, we know the size of the adjacency matrix
-    adj_matrix.assign((size_t)max_label * (size_t)max_label,
-                      Adjacency_Info::NOT_ADJACENT);
-
-    uint_fast16_t node_1,
-        node_2; // to temporarily store node values read in from the data block
-    bool second_node =
-        false; // to track which node (first or second on a given line) we're on
-
-    curr = data_start;
-    if (!(curr < file_length)) [[unlikely]] {
+    std::vector<std::vector<ADJ_LIST_ENTRY>> block_entries(num_blocks);
+    std::vector<uint_fast32_t> block_max_labels(num_blocks, 0);
+    std::vector<const char *> block_bad_entries(num_blocks, NULL);
+    run_adj_load_threads(num_blocks, [&](const size_t block) {
+        // each "node_1,node_2" entry takes up at least 4 characters, which
+        // gives us a decent upper bound on how many entries there are
+        block_entries[block].reserve(
+            (size_t)(block_bounds[block + 1] - block_bounds[block]) / 4 + 1);
+        block_bad_entries[block] = parse_adj_entries(
+            block_bounds[block], block_bounds[block + 1],
+            &block_entries[block], &block_max_labels[block]);
+    });
+
+    // the first malformed entry in the file is in the earliest block with one
+    const auto bad_block =
+        std::find_if(block_bad_entries.begin(), block_bad_entries.end(),
+                     [](const char *bad) { return bad != NULL; });
+    if (bad_block != block_bad_entries.end()) [[unlikely]] {
+        const char *const bad_entry = *bad_block;
         DISPLAY_ERR(true,
                     "Issue parsing the adjacency information file loaded into "
-                    "memory.\nReached the end of the file earlier than "
-                    "expected.\nFile path: %s",
+                    "memory.\nMalformed entry (or label over %u) at byte "
+                    "%zu: \"%.*s\"\nFile path: %s",
+                    (unsigned)(ADJ_WIDE_MAX_NODES - 1),
+                    (size_t)(bad_entry - file.data),
+                    (int)std::min<ptrdiff_t>(end - bad_entry, 16), bad_entry,
                     file_path.string().c_str());
-        return adj_matrix;
-    }
-    while (curr < file_length) {
-        if (std::isdigit(data[curr])) [[likely]] {
-            if (!second_node) { // reading in the first digit in a pair
-                node_1 = std::atoi(&data[curr]);
-                curr += num_digits(node_1); // advance to the first char past
-                                            // that of the number's
-                // we shouldn't be at the end of the file, AND the next
-                // character has to be a comma
-                if (!(curr < file_length && data[curr] == ',')) {
-                    DISPLAY_ERR(true,
-                                "Issue parsing the adjacency information file "
-                                "loaded into memory.\nDidn't encounter a comma "
-                                "when one was expected, or EOF was encountered "
-                                "unexpectedly.\nFile path: %s",
-                                file_path.string().c_str());
-                    return adj_matrix;
-                }
-                curr++; // advance one more character to skip the comma
-                        // separating the two digits
-                second_node = true;
-                continue;
-            } else { // reading in the second digit
-                node_2 = std::atoi(&data[curr]);
-                curr += num_digits(node_2); // advance to the first char past
-                                            // that of the number's
-                if (curr <
-                    file_length) { // if we're not at the end of the file...
-                    // extra OR added to allow for the continued use of old
-                    // files with the '\n' delimiter, should be fine to leave
-                    // this here
-                    if (!(data[curr] == ADJ_FILE_DELIM ||
-                          data[curr] ==
-                              '\n')) { // ...there should be a newline (or our
-                                       // updated delimiter) character next
-                        DISPLAY_ERR(
-                            true,
-                            "Issue parsing the adjacency information file "
-                            "loaded into memory.\nDidn't encounter a delimiter "
-                            "when one was expected.\nFile path: %s",
-                            file_path.string().c_str());
-                        return adj_matrix;
-                    }
-                }
-                curr++; // advance one more character to skip the newline char
-                adj_matrix[index_translation(max_label, node_1, node_2)] =
-                    Adjacency_Info::ADJACENT; // mark the appropriate entries in
-                                              // the adjacency matrix
-                adj_matrix[index_translation(max_label, node_2, node_1)] =
-                    Adjacency_Info::ADJACENT; // ^
-                second_node = false;
-                continue;
-            }
-        } else [[unlikely]] { // something went wrong, return the empty vector
-                              // but don't set the success_out flag
-            DISPLAY_ERR(
-                true,
-                "Issue parsing the adjacency information file loaded into "
-                "memory.\nUnspecified parsing error.\nFile path: %s",
-                file_path.string().c_str());
-            return adj_matrix;
+        return graph;
+    }
+
+    std::vector<ADJ_LIST_ENTRY> entries;
+    uint_fast32_t max_label = 0;
+    if (num_blocks == 1) [[likely]] {
+        entries.swap(block_entries[0]);
+        max_label = block_max_labels[0];
+    } else {
+        std::vector<size_t> block_starts(num_blocks + 1, 0);
+        for (size_t i = 0; i < num_blocks; i++) {
+            block_starts[i + 1] = block_starts[i] + block_entries[i].size();
+            max_label = std::max(max_label, block_max_labels[i]);
         }
+        entries.resize(block_starts[num_blocks]);
+        run_adj_load_threads(num_blocks, [&](const size_t block) {
+            std::copy(block_entries[block].begin(), block_entries[block].end(),
+                      entries.begin() + block_starts[block]);
+            std::vector<ADJ_LIST_ENTRY>().swap(block_entries[block]);
+        });
+    }
+    if (entries.empty() || entries.size() > ADJ_MAX_EDGES) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "The adjacency information file has no entries, or more "
+                    "than %u of them.\nFile path: %s",
+                    (unsigned)ADJ_MAX_EDGES, file_path.string().c_str());
+        return graph;
     }
 
+    graph = build_any_adjacency_csr(entries, max_label + 1);
     *success_out = true;
-    return adj_matrix;
+    return graph;
 }
 
 // Generating functions
@@ -300,256 +581,180 @@ load_adjacency_info(const std::filesystem::path file_path,
 // buffering is a thing but may still be the best practice would need to develop
 // means to calculating the required buffer size beforehand.... this isn't
 // something that's getting called repeatedly, delay likely not to be an issue
+
+// Where a generator's entries go: written to a file as a text adjacency
+// listing, or collected in memory (to build a graph file from, see
+// Graph_File.h). Exactly one of text/ entries should be set
+typedef struct ADJ_LIST_OUT {
+    FILE *text = NULL;
+    std::vector<ADJ_LIST_ENTRY> *entries = NULL;
+    bool has_entry = false; // at least one entry has been put out
+} ADJ_LIST_OUT;
+
 /****************************************************************************
- * generalized_petersen_gen
+ * start_adj_list
  *
- * - Writes an adjacency listing for a generalized petersen graph of the
- * specified parameters to the file stream
- * - https://mathworld.wolfram.com/GeneralizedPetersenGraph.html
+ * - Lil helper function, starts a generator's output: writes the label at the
+ * top of a text listing so we know what it is
+ * - Checks that the graph about to be put out can be loaded back in first
+ * (see ADJ_WIDE_MAX_NODES and ADJ_MAX_EDGES), so that parameters that are too
+ * big get turned away instead of wrapping around to a different graph
  *
  * Parameters :
- * - output : file stream to write the adjacency listing to
- * - n : graph parameter
- *	- number of nodes on a ring in the graph
- * - k : graph parameter
- *	- how many nodes away the inner rings are connected
+ * - output : where the generator's entries go
+ * - num_nodes : the number of nodes the graph will have
+ * - num_entries : the number of entries that will be put out
  *
  * Returns :
- * - none
+ * - bool : false if output has nowhere to put the entries, or the graph is
+ * too big
  ****************************************************************************/
-void generalized_petersen_gen(FILE *__restrict output, const uint_fast16_t n,
-                              const uint_fast16_t k) {
-    if (output == NULL) [[unlikely]] {
+inline bool start_adj_list(ADJ_LIST_OUT &__restrict output,
+                           const uint_fast64_t num_nodes,
+                           const uint_fast64_t num_entries) {
+    if (output.text == NULL && output.entries == NULL) [[unlikely]] {
         DISPLAY_ERR(true, "Invalid file stream.");
-        return;
+        return false;
     }
-    fprintf(output, "Adjacency_Listing\n"); // label at the top of the file so
-                                            // we know what it is
-
-    // outer ring connections to adjacent nodes around the ring
-    for (uint_fast16_t i = 0; i < n; i++) {
-        fprintf(output, "%hu,%hu%c", (uint16_t)i, (uint16_t)((i + 1) % n),
-                ADJ_FILE_DELIM);
+    if (num_nodes > ADJ_WIDE_MAX_NODES || num_entries > ADJ_MAX_EDGES)
+        [[unlikely]] {
+        DISPLAY_ERR(false,
+                    "The graph is too big, graphs can have at most %u nodes "
+                    "and %u edges.",
+                    (unsigned)ADJ_WIDE_MAX_NODES, (unsigned)ADJ_MAX_EDGES);
+        return false;
     }
-    // outer ring to inner ring "spokes"
-    for (uint_fast16_t i = 0; i < n; i++) {
-        fprintf(output, "%hu,%hu%c", (uint16_t)i, (uint16_t)(i + n),
-                ADJ_FILE_DELIM);
+    if (output.entries != NULL) {
+        output.entries->reserve(output.entries->size() + num_entries);
     }
-    // inner ring connections (ew)
-    for (uint_fast16_t i = n; i < (2 * n) - 1; i++) {
-        fprintf(output, "%hu,%hu%c", (uint16_t)i, (uint16_t)(((i + k) % n) + n),
-                ADJ_FILE_DELIM);
-    }
-    // also an inner ring connection
-    fprintf(output, "%hu,%hu", (uint16_t)((2 * n) - 1),
-            (uint16_t)(((((2 * n) - 1) + k) % n) +
-                       n)); // last entry does NOT get a newline char after it
+    if (output.text != NULL) {
+        fprintf(output.text, "Adjacency_Listing\n");
+    }
+    output.has_entry = false;
+    return true;
 }
 
 /****************************************************************************
- * stacked_prism_gen
+ * put_adj_entry
  *
- * - Writes an adjacency listing for a stacked prism graph of the
- * specified parameters to the file stream
- * - https://mathworld.wolfram.com/StackedPrismGraph.html
+ * - Lil helper function, puts out a single "node_1,node_2" entry. Entries in
+ * a text listing are separated by ADJ_FILE_DELIM, with none after the last
+ * one
  *
  * Parameters :
- * - output : file stream to write the adjacency listing to
- * - n : graph parameter
- *	- number of nodes on a ring in the graph
- * - m : graph parameter
- *	- how many stacked prisms the graph has
+ * - output : where the generator's entries go
+ * - node_1, node_2 : the entry's nodes
  *
  * Returns :
  * - none
  ****************************************************************************/
-void stacked_prism_gen(FILE *__restrict output, const uint_fast16_t m,
-                       const uint_fast16_t n) {
-    if (output == NULL) [[unlikely]] {
-        DISPLAY_ERR(true, "Invalid file stream.");
-        return;
-    }
-    fprintf(output, "Adjacency_Listing\n"); // label at the top of the file so
-                                            // we know what it is
-
-    for (uint_fast16_t i = 0; i < n; i++) {
-        for (uint_fast16_t j = 0; j < m - 1; j++) {
-            fprintf(output, "%hu,%hu%c", (uint16_t)(j + (i * m)),
-                    (uint16_t)(j + 1 + (i * m)), ADJ_FILE_DELIM);
-        }
-        fprintf(output, "%hu,%hu", (uint16_t)(m - 1 + (i * m)),
-                (uint16_t)(i * m));
-        if (i != (n - 1)) { // doing this to avoid placing a newline char at the
-                            // end of the file
-            fprintf(output, "%c", ADJ_FILE_DELIM);
-        }
-        if (i < n - 1) {
-            for (uint_fast16_t k = 0; k < m; k++) {
-                fprintf(output, "%hu,%hu%c", (uint16_t)(k + (i * m)),
-                        (uint16_t)(k + ((i + 1) * m)), ADJ_FILE_DELIM);
-            }
+inline void put_adj_entry(ADJ_LIST_OUT &__restrict output,
+                          const uint_fast32_t node_1,
+                          const uint_fast32_t node_2) {
+    if (output.text != NULL) {
+        if (output.has_entry) {
+            fputc(ADJ_FILE_DELIM, output.text);
         }
+        fprintf(output.text, "%u,%u", (unsigned)node_1, (unsigned)node_2);
+    } else {
+        output.entries->emplace_back((uint32_t)node_1, (uint32_t)node_2);
     }
-}
-
-/*
- *
- * - A brief discussion before the Z_m^n generation code
- * - This is a bit gross. I remember talking with Dr. Gates
- * regarding a good way to generate all the members of a given Z_m^n
- * group, and the recursive solution is what we came up with
- * - An iterative solution would likely be much clearer and vastly preferred,
- *but for now this works and we're moving on
- * - The original implementation of this used std::vectors and a crappy little
- * tuple template class I wrote
- *	- While it may make sense to switch back to using the template class later,
- *for now I'll just go with the approach below
- *
- * - I decided to do it with a single dimensional array, where the tuples are
- *just laid out next to eachother, and it's more reliant on the function using
- *this stored info to know what's what
- *
- */
-
-/****************************************************************************
- * tuple_to_index
- *
- * - Given an array holding some number of tuples as adjacent entries,
- * calculates the index in said array for the specified entry within the
- * specified tuple
- *
- * Parameters :
- * - n : number of entries per tuple
- * - tuple_num : which tuple we're accessing within the array of tuples
- * - tuple_entry : which entry we're accessing within said tuple
- *
- * Returns :
- * - uint_fast16_t : the index in the array for said entry within the specified
- * tuple
- ****************************************************************************/
-inline size_t tuple_to_index(const uint_fast32_t n,
-                             const uint_fast32_t tuple_num,
-                             const uint_fast32_t tuple_entry) {
-    return (size_t)((n * tuple_num) + tuple_entry);
+    output.has_entry = true;
 }
 
 /****************************************************************************
- * tupls_adj
+ * generalized_petersen_gen
  *
- * - Determines whether two tuples are adjacent
- *   - tuples are adjacent IFF they differ by 1 mod M in exactly one coordiante
- * - The two tuples MUST be of the same length
+ * - Puts out an adjacency listing for a generalized petersen graph of the
+ * specified parameters
+ * - https://mathworld.wolfram.com/GeneralizedPetersenGraph.html
  *
  * Parameters :
- * - tuple_holder : pointer to an array holding the values of all tuples
- * - start_index_1 : index of the first entry of the first tuple in tuple_holder
- * - start_index_2 : index of the first entry of the second tuple in
- *tuple_holder
- * - m : graph parameter
- *	- corresponds to m in Z_m^n
- * - num_entries : the number of entries in the two tuples
- *	- corresponds to n in Z_m^n
+ * - output : where to put the adjacency listing
+ * - n : graph parameter
+ *	- number of nodes on a ring in the graph
+ * - k : graph parameter
+ *	- how many nodes away the inner rings are connected
  *
  * Returns :
- * - bool : whether tuple_1 and tuple_2 are adjacent
+ * - bool : false if the graph couldn't be put out (too big)
  ****************************************************************************/
-bool tuples_adj(const std::vector<uint_fast16_t> &__restrict tuple_holder,
-                const size_t start_index_1, const size_t start_index_2,
-                const uint_fast16_t m, const uint_fast16_t num_entries) {
-    bool found_coord = false;
-
-    for (uint_fast16_t entry = 0; entry < num_entries; entry++) {
-        uint_fast16_t entry_1 = tuple_holder[start_index_1 + entry];
-        uint_fast16_t entry_2 = tuple_holder[start_index_2 + entry];
-
-        int32_t diff = (int32_t)entry_1 - (int32_t)entry_2;
-        if (diff == 0) { // coordinates match, continue iterating
-            continue;
-        } else if (std::abs((diff) % (int32_t)m) == 1 ||
-                   (entry_1 + 1) % m == entry_2 ||
-                   (entry_2 + 1) % m == entry_1) { // coordinates differ by one
-            if (found_coord) { // more than one coordinate differs by one, not
-                               // adjacent
-                return false;
-            }
-            found_coord =
-                true; // first coordinate to differ by one, keep iterating
-        } else { // distance in coordinates is greater than one, not adjacent
-            return false;
-        }
+bool generalized_petersen_gen(ADJ_LIST_OUT &__restrict output,
+                              const uint_fast32_t n, const uint_fast32_t k) {
+    if (!start_adj_list(output, 2 * (uint_fast64_t)n, 3 * (uint_fast64_t)n))
+        [[unlikely]] {
+        return false;
     }
 
-    return found_coord;
+    // outer ring connections to adjacent nodes around the ring
+    for (uint_fast64_t i = 0; i < n; i++) {
+        put_adj_entry(output, i, (i + 1) % n);
+    }
+    // outer ring to inner ring "spokes"
+    for (uint_fast64_t i = 0; i < n; i++) {
+        put_adj_entry(output, i, i + n);
+    }
+    // inner ring connections (ew)
+    for (uint_fast64_t i = n; i < 2 * (uint_fast64_t)n; i++) {
+        put_adj_entry(output, i, ((i + k) % n) + n);
+    }
+    return true;
 }
 
 /****************************************************************************
- * z_mn_group_gen
+ * stacked_prism_gen
  *
- * - Helper function for z_mn_gen
- * - Generates all the entries of a given Z_m^n group and places them in the
- * passed in array
+ * - Puts out an adjacency listing for a stacked prism graph of the
+ * specified parameters
+ * - https://mathworld.wolfram.com/StackedPrismGraph.html
  *
  * Parameters :
- * - member_list : array of size n * m^n that holds every member of a given
- * Z_m^n group
- *	- passed in by reference, so once it's filled, the caller has access
- * - value_holder : temporary array that holds the "current value" of the
- * tuple being generated at various points within the tuple
- *	- passed by reference so its value persists throughout recursive calls,
- *	contents mean nothing to the caller
- * - place_in_tuple : the current point in the n-tuple being filled
- * - place_in_member_list : holds the current entry the the member_list array
- * for the current tuple to be entered
- *	 - holds the tuple number (in terms of the first tuple being generated,
- * the second, third, and so on....), not an actual address/ offset in bytes
- *	- passed by reference so its value persists throughout recursive calls,
- *	contents mean nothing to the caller
- * - m : graph parameter
- *	- each tuple entry can range from 0 to m-1
+ * - output : where to put the adjacency listing
  * - n : graph parameter
- *	- the number of entries in each tuple
+ *	- number of nodes on a ring in the graph
+ * - m : graph parameter
+ *	- how many stacked prisms the graph has
  *
  * Returns :
- * - none
+ * - bool : false if the graph couldn't be put out (too big)
  ****************************************************************************/
-void z_mn_group_gen(std::vector<uint_fast16_t> &__restrict member_list,
-                    std::vector<uint_fast16_t> &__restrict value_holder,
-                    const uint_fast16_t place_in_tuple,
-                    uint_fast16_t *__restrict place_in_member_list,
-                    const uint_fast16_t m, const uint_fast16_t n) {
-    if (place_in_tuple < (n - 1)) {
-        for (uint_fast16_t i = 0; i < m; i++) {
-            value_holder[place_in_tuple] = i;
-            z_mn_group_gen(member_list, value_holder, place_in_tuple + 1,
-                           place_in_member_list, m, n);
+bool stacked_prism_gen(ADJ_LIST_OUT &__restrict output, const uint_fast32_t m,
+                       const uint_fast32_t n) {
+    const uint_fast64_t num_nodes = (uint_fast64_t)m * n;
+    if (!start_adj_list(output, num_nodes,
+                        2 * num_nodes - std::min<uint_fast64_t>(m, num_nodes)))
+        [[unlikely]] {
+        return false;
+    }
+
+    for (uint_fast64_t i = 0; i < n; i++) {
+        for (uint_fast64_t j = 0; j < m - 1; j++) {
+            put_adj_entry(output, j + (i * m), j + 1 + (i * m));
         }
-    } else {
-        for (uint_fast16_t i = 0; i < m; i++) {
-            value_holder[place_in_tuple] =
-                i; // replace place_in_tuple with n-1 here?
-
-            for (uint_fast16_t j = 0; j < n; j++) {
-                // set the jth entry of the place_in_member_list tuple with the
-                // value of value_holder[j]
-                member_list[tuple_to_index(n, *place_in_member_list, j)] =
-                    value_holder[j];
+        put_adj_entry(output, m - 1 + (i * m), i * m);
+        if (i < n - 1) {
+            for (uint_fast64_t k = 0; k < m; k++) {
+                put_adj_entry(output, k + (i * m), k + ((i + 1) * m));
             }
-            *place_in_member_list +=
-                1; // move to the next tuple in our member_list array
         }
     }
+    return true;
 }
 
 /****************************************************************************
  * z_mn_gen
  *
- * - Calls z_mn_group_gen() to generate all members of a given Z_m^n group,
- * and then writes said group's adjacenecy listing to the supplied file stream
+ * - Puts out the adjacency listing for a given Z_m^n group, where two
+ * n-tuples are adjacent IFF they differ by 1 mod m in exactly one coordinate
+ * - Tuples are numbered as base m numbers with the first coordinate the most
+ * significant, so a tuple's neighbors are found directly by stepping one
+ * digit up or down with wraparound, O(n) work per tuple
+ * - Each edge is put out once, from its lower numbered end. Going from the
+ * least significant digit up, the neighbors above a tuple come out in
+ * ascending order without any sorting
  *
  * Parameters :
- * - output : the file stream to write the adjacency listing to
- *	- passed in by reference, so once it's filled, the caller has access
+ * - output : where to put the adjacency listing
  * - m : graph parameter
  *	- each tuple entry can range from 0 to m-1
  * - n : graph parameter
@@ -558,48 +763,50 @@ void z_mn_group_gen(std::vector<uint_fast16_t> &__restrict member_list,
  * Returns :
  * - bool : true to indicate success, false to indicate failure
  ****************************************************************************/
-// check if casts are needed here...
-bool z_mn_gen(FILE *__restrict output, const uint_fast16_t m,
-              const uint_fast16_t n) {
-    if (output == NULL) [[unlikely]] {
-        DISPLAY_ERR(true, "Invalid file stream.");
+bool z_mn_gen(ADJ_LIST_OUT &__restrict output, const uint_fast32_t m,
+              const uint_fast32_t n) {
+    // m^n, worked out a step at a time so it can't overflow (anything past
+    // ADJ_WIDE_MAX_NODES gets turned away by start_adj_list anyway)
+    uint_fast64_t num_tuples = 1;
+    for (uint_fast32_t i = 0; i < n && num_tuples <= ADJ_WIDE_MAX_NODES; i++) {
+        num_tuples *= m;
+    }
+    // each tuple has 2 neighbors per coordinate, or just 1 when m is 2
+    const uint_fast64_t num_entries =
+        num_tuples * n / (m == 2 ? 2 : 1);
+    if (!start_adj_list(output, num_tuples, num_entries)) [[unlikely]] {
         return false;
     }
 
-    uint_fast16_t num_tuples = (uint16_t)std::pow(m, n);
-    std::vector<uint_fast16_t> value_holder(n);
-    std::vector<uint_fast16_t> member_list(num_tuples * n);
-    uint_fast16_t place_in_member_list = 0;
-    bool has_entry = false;
-
-    // common sense checks here to make sure vector allocated all of the
-    // memory...
-    if (num_tuples == 0 ||
-        (member_list.size() != ((size_t)num_tuples * (size_t)n))) [[unlikely]] {
-        DISPLAY_ERR(true,
-                    "Failed to allocate the necessary memory to generate the "
-                    "adjacency listing! Attempted to allocatte %zu bytes.",
-                    (size_t)(std::pow(m, n) * n));
-        return false;
+    // strides[k] is how far apart two tuples differing by 1 in coordinate k
+    // are, digits holds the current tuple and is counted up alongside it
+    std::vector<uint_fast64_t> strides(n);
+    std::vector<uint_fast32_t> digits(n, 0);
+    uint_fast64_t stride = 1;
+    for (uint_fast32_t k = n; k-- > 0;) {
+        strides[k] = stride;
+        stride *= m;
     }
 
-    z_mn_group_gen(member_list, value_holder, 0, &place_in_member_list, m, n);
-
-    // output to file
-    fprintf(output, "Adjacency_Listing\n");
-    for (uint_fast16_t i = 0; i < num_tuples; i++) {
-        for (uint_fast16_t j = i; j < num_tuples; j++) {
-            if (tuples_adj(member_list, (size_t)i * (size_t)n,
-                           (size_t)j * (size_t)n, m, n)) {
-                if (has_entry == true) { // doing this to avoid a newline
-                                         // character at the end of the file
-                    fprintf(output, "%c%hu,%hu", ADJ_FILE_DELIM, (uint16_t)i,
-                            (uint16_t)j);
-                } else {
-                    fprintf(output, "%hu,%hu", (uint16_t)i, (uint16_t)j);
-                }
-                has_entry = true;
+    for (uint_fast64_t i = 0; i < num_tuples; i++) {
+        for (uint_fast32_t k = n; k-- > 0;) {
+            // stepping up without wrapping always lands above i
+            if (digits[k] + 1 < m) {
+                put_adj_entry(output, i, i + strides[k]);
+            }
+            // stepping down from 0 wraps to m-1, which is above i as well
+            // (for m == 2 that's the same tuple as stepping up)
+            if (digits[k] == 0 && m > 2) {
+                put_adj_entry(output, i, i + (m - 1) * strides[k]);
+            }
+        }
+
+        // move the digits on to tuple i+1
+        for (uint_fast32_t k = n; k-- > 0;) {
+            if (++digits[k] < m) {
+                break;
             }
+            digits[k] = 0;
         }
     }
 
@@ -0,0 +1,327 @@
+#pragma once
+/*
+ *
+ * - This file holds the code for finding a graph's automorphisms (symmetries)
+ * and for using them to put positions into a canonical form
+ * - Most of the graph families we play on (Generalized Petersen, Stacked
+ * Prism, Z_m^n) have big symmetry groups, so a lot of the positions in the
+ * early game are just rotated/ reflected/ translated copies of each other.
+ * Mapping every early game position to a single representative of its class
+ * before looking it up in the transposition table means each class is only
+ * solved once
+ * - Any automorphism maps a position to one with the same result, so even an
+ * incomplete list of automorphisms gives correct results, just fewer hits
+ *
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Transposition_Table.h"
+
+// Upper limit on how many automorphisms are kept. Z_m^n in particular has
+// groups far larger than is useful (or cheap) to canonicalize with
+#define AUT_MAX_GROUP_SIZE 4096
+// Upper limit on the number of candidate images tried by the search, so that
+// an unlucky graph can't hang the program at load time
+#define AUT_MAX_SEARCH_STEPS 10000000ULL
+
+// All of the automorphisms found for a graph, each stored as a permutation of
+// the node labels (perm[old label] = new label), back to back
+typedef struct AUTOMORPHISM_GROUP {
+    size_t num_nodes = 0;
+    std::vector<uint16_t> perms;
+    bool complete = true; // false if the search stopped early
+
+    inline size_t size() const {
+        return num_nodes > 0 ? perms.size() / num_nodes : 0;
+    }
+    inline const uint16_t *perm(const size_t index) const {
+        return &perms[index * num_nodes];
+    }
+} AUTOMORPHISM_GROUP;
+
+/****************************************************************************
+ * csr_has_edge
+ *
+ * - Helper function, checks whether two nodes are adjacent
+ * - Relies on the CSR rows being sorted in ascending order
+ *
+ * Parameters :
+ * - graph : the graph in question
+ * - node_1, node_2 : the nodes in question
+ *
+ * Returns :
+ * - bool : whether there's an edge between node_1 and node_2
+ ****************************************************************************/
+inline bool csr_has_edge(const ADJACENCY_CSR &__restrict graph,
+                         const uint_fast16_t node_1,
+                         const uint_fast16_t node_2) {
+    return std::binary_search(graph.neighbors + graph.offsets[node_1],
+                              graph.neighbors + graph.offsets[node_1 + 1],
+                              (uint16_t)node_2);
+}
+
+/****************************************************************************
+ * find_automorphisms
+ *
+ * - Finds the automorphisms of a graph with a backtracking search
+ * - Nodes are assigned images in breadth first order, so every node other than
+ * the first one in each connected component has an already mapped neighbor,
+ * and its image has to be one of that neighbor's image's neighbors. That keeps
+ * the number of candidates at each step down to the node degree
+ * - A candidate image is accepted when it has the same degree as the node, it
+ * hasn't been used yet, and the node's already mapped neighbors are mapped to
+ * exactly the already used neighbors of the candidate
+ *
+ * Parameters :
+ * - graph : the graph to search
+ * - group : where the automorphisms are written. Any previous contents are
+ * thrown out
+ *
+ * Returns :
+ * - size_t : the number of automorphisms found
+ ****************************************************************************/
+size_t find_automorphisms(const ADJACENCY_CSR &__restrict graph,
+                          AUTOMORPHISM_GROUP *__restrict group) {
+    const size_t num_nodes = graph.num_nodes;
+    *group = AUTOMORPHISM_GROUP{};
+    group->num_nodes = num_nodes;
+    if (num_nodes == 0) [[unlikely]] {
+        return 0;
+    }
+
+    // breadth first order over every component, along with the (already
+    // visited) node each node was discovered from
+    constexpr uint32_t NO_PARENT = UINT32_MAX;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> parent(num_nodes, NO_PARENT);
+    std::vector<bool> seen(num_nodes, false);
+    order.reserve(num_nodes);
+    for (uint32_t root = 0; root < num_nodes; root++) {
+        if (seen[root]) {
+            continue;
+        }
+        seen[root] = true;
+        order.push_back(root);
+        for (size_t head = order.size() - 1; head < order.size(); head++) {
+            const uint32_t node = order[head];
+            for (uint32_t i = graph.offsets[node]; i < graph.offsets[node + 1];
+                 i++) {
+                const uint32_t neighbor = graph.neighbors[i];
+                if (!seen[neighbor]) {
+                    seen[neighbor] = true;
+                    parent[neighbor] = node;
+                    order.push_back(neighbor);
+                }
+            }
+        }
+    }
+
+    constexpr uint32_t UNMAPPED = UINT32_MAX;
+    std::vector<uint32_t> image(num_nodes, UNMAPPED);
+    std::vector<bool> image_used(num_nodes, false);
+    std::vector<uint32_t> next_cand(num_nodes + 1, 0);
+    uint64_t steps = 0;
+    size_t level = 0;
+
+    auto degree = [&graph](const uint32_t node) {
+        return graph.offsets[node + 1] - graph.offsets[node];
+    };
+
+    while (true) {
+        if (level == num_nodes) { // every node is mapped, record it
+            for (uint32_t node = 0; node < num_nodes; node++) {
+                group->perms.push_back((uint16_t)image[node]);
+            }
+            if (group->size() >= AUT_MAX_GROUP_SIZE) {
+                group->complete = false;
+                break;
+            }
+            level--;
+            image_used[image[order[level]]] = false;
+            image[order[level]] = UNMAPPED;
+            continue;
+        }
+
+        const uint32_t node = order[level];
+        const uint32_t anchor = parent[node];
+        const uint32_t num_cands =
+            anchor == NO_PARENT ? (uint32_t)num_nodes : degree(image[anchor]);
+        bool mapped = false;
+        while (next_cand[level] < num_cands) {
+            const uint32_t cand =
+                anchor == NO_PARENT
+                    ? next_cand[level]
+                    : graph.neighbors[graph.offsets[image[anchor]] +
+                                      next_cand[level]];
+            next_cand[level]++;
+            if (++steps > AUT_MAX_SEARCH_STEPS) [[unlikely]] {
+                break;
+            }
+            if (image_used[cand] || degree(cand) != degree(node)) {
+                continue;
+            }
+
+            // mapped neighbors of node have to land on neighbors of cand...
+            uint32_t mapped_neighbors = 0;
+            bool consistent = true;
+            for (uint32_t i = graph.offsets[node]; i < graph.offsets[node + 1];
+                 i++) {
+                const uint32_t neighbor = graph.neighbors[i];
+                if (image[neighbor] != UNMAPPED) {
+                    mapped_neighbors++;
+                    if (!csr_has_edge(graph, cand, image[neighbor])) {
+                        consistent = false;
+                        break;
+                    }
+                }
+            }
+            // ...and cand can't have any other used neighbors
+            uint32_t used_neighbors = 0;
+            for (uint32_t i = graph.offsets[cand];
+                 consistent && i < graph.offsets[cand + 1]; i++) {
+                used_neighbors += image_used[graph.neighbors[i]] ? 1 : 0;
+            }
+            if (!consistent || used_neighbors != mapped_neighbors) {
+                continue;
+            }
+
+            image[node] = cand;
+            image_used[cand] = true;
+            mapped = true;
+            break;
+        }
+
+        if (steps > AUT_MAX_SEARCH_STEPS) [[unlikely]] {
+            group->complete = false;
+            break;
+        }
+        if (mapped) {
+            level++;
+            next_cand[level] = 0;
+            continue;
+        }
+        // out of candidates at this level, back up a level
+        if (level == 0) {
+            break;
+        }
+        level--;
+        image_used[image[order[level]]] = false;
+        image[order[level]] = UNMAPPED;
+    }
+
+    return group->size();
+}
+
+/****************************************************************************
+ * canonical_position
+ *
+ * - Maps a position (current node + set of visited nodes) to the image under
+ * the graph's automorphisms with the smallest Zobrist hash, which every
+ * position in its symmetry class maps to as well (barring two different images
+ * sharing a hash, which just costs a missed table hit)
+ *
+ * Parameters :
+ * - group : the graph's automorphisms
+ * - keys : the graph's Zobrist keys
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ * - visited_scratch : scratch space, overwritten
+ * - canon_node_out : where the canonical current node is written
+ * - canon_words_out : where the canonical packed node use list is written,
+ * must have room for node_words.size() words
+ *
+ * Returns :
+ * - uint64_t : the Zobrist hash of the canonical position
+ ****************************************************************************/
+uint64_t canonical_position(const AUTOMORPHISM_GROUP &__restrict group,
+                            const ZOBRIST_KEYS &__restrict keys,
+                            const uint_fast16_t curr_node,
+                            const std::vector<uint64_t> &__restrict node_words,
+                            std::vector<uint16_t> &__restrict visited_scratch,
+                            uint32_t *__restrict canon_node_out,
+                            uint64_t *__restrict canon_words_out) {
+    visited_scratch.clear();
+    for (size_t word = 0; word < node_words.size(); word++) {
+        for (uint64_t bits = node_words[word]; bits != 0; bits &= bits - 1) {
+            visited_scratch.push_back(
+                (uint16_t)(word * 64 + std::countr_zero(bits)));
+        }
+    }
+
+    uint64_t best_hash = UINT64_MAX;
+    size_t best_perm = 0;
+    for (size_t index = 0; index < group.size(); index++) {
+        const uint16_t *perm = group.perm(index);
+        uint64_t hash = keys.current_keys[perm[curr_node]];
+        for (const uint16_t node : visited_scratch) {
+            hash ^= keys.visited_keys[perm[node]];
+        }
+        if (hash < best_hash) {
+            best_hash = hash;
+            best_perm = index;
+        }
+    }
+
+    const uint16_t *perm = group.perm(best_perm);
+    std::fill(canon_words_out, canon_words_out + node_words.size(), 0);
+    for (const uint16_t node : visited_scratch) {
+        canon_words_out[perm[node] >> 6] |= (uint64_t)1 << (perm[node] & 63);
+    }
+    *canon_node_out = perm[curr_node];
+
+    return best_hash;
+}
+
+/****************************************************************************
+ * find_orbits
+ *
+ * - Splits the nodes of a graph up into orbits: sets of nodes that the graph's
+ * automorphisms map onto each other, and so play out the same way as starting
+ * nodes
+ * - If the group is incomplete, the orbits found may be split up more finely
+ * than the real ones, which only means some extra work for the caller
+ *
+ * Parameters :
+ * - group : the graph's automorphisms
+ *
+ * Returns :
+ * - std::vector<uint16_t> : for each node, the smallest node in its orbit
+ ****************************************************************************/
+std::vector<uint16_t> find_orbits(const AUTOMORPHISM_GROUP &__restrict group) {
+    std::vector<uint16_t> orbit_rep(group.num_nodes);
+    for (size_t node = 0; node < group.num_nodes; node++) {
+        orbit_rep[node] = (uint16_t)node;
+    }
+
+    // union-find, always keeping the smaller label as the root
+    auto find_rep = [&orbit_rep](uint16_t node) {
+        while (orbit_rep[node] != node) {
+            orbit_rep[node] = orbit_rep[orbit_rep[node]];
+            node = orbit_rep[node];
+        }
+        return node;
+    };
+    for (size_t index = 0; index < group.size(); index++) {
+        const uint16_t *perm = group.perm(index);
+        for (size_t node = 0; node < group.num_nodes; node++) {
+            const uint16_t rep_1 = find_rep((uint16_t)node);
+            const uint16_t rep_2 = find_rep(perm[node]);
+            if (rep_1 < rep_2) {
+                orbit_rep[rep_2] = rep_1;
+            } else if (rep_2 < rep_1) {
+                orbit_rep[rep_1] = rep_2;
+            }
+        }
+    }
+    for (size_t node = 0; node < group.num_nodes; node++) {
+        orbit_rep[node] = find_rep((uint16_t)node);
+    }
+
+    return orbit_rep;
+}
@@ -0,0 +1,1126 @@
+#pragma once
+/*
+ *
+ * - This file holds the program's command line (batch) mode, which plays games
+ * on any number of graphs without going through the interactive menus, so runs
+ * can be scripted
+ * - If the program is started with any arguments, main() hands them over to
+ * batch_main() instead of opening the main menu
+ * - Every game played (or skipped over because of a timeout/ error) gets one
+ * line of JSON written to stdout, as soon as it's done. Everything else
+ * (errors, the summary at the end) goes to stderr, so stdout can be piped
+ * straight into a file or another program
+ *
+ * Example:
+ *	Cycle_Games --games mac,aac --starts all --timeout 600 \
+ *		Adjacency_Information/Stacked_Prism > results.jsonl
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Automorphism.h"
+#include "Cycle_Games.h"
+#include "Cycle_Games_DFPN.h"
+#include "Cycle_Games_Threaded.h"
+#include "Graph_File.h"
+#include "Menu.h"
+#include "Mirror.h"
+#include "Misc.h"
+#include "Transposition_Table.h"
+
+// Exit codes, from best to worst. When several things go wrong the worst one
+// is what gets returned
+#define BATCH_EXIT_OK 0        // every requested game was played to the end
+#define BATCH_EXIT_TIMEOUT 1   // at least one game ran past the timeout
+#define BATCH_EXIT_BAD_INPUT 2 // at least one file/ start node was unusable
+#define BATCH_EXIT_USAGE 3     // bad command line arguments, nothing was run
+#define BATCH_EXIT_MISMATCH 4  // the search and the maximum matching disagreed
+                               // on an AAC game (--aac-solver both)
+
+// Longest timeout taken as given (a bit over 3 years), anything longer is as
+// good as no limit and is treated as such. Much longer would overflow the
+// clock's duration and put the deadline in the past
+#define BATCH_MAX_TIMEOUT_SEC 1e8
+
+// Everything the command line can ask for
+typedef struct BATCH_OPTIONS {
+    std::vector<std::filesystem::path> files;
+    bool play_MAC = true;
+    bool play_AAC = true;
+    bool all_starts = true;
+    std::vector<uint_fast32_t> starts; // only used if all_starts is false
+    bool loud = false;
+    double timeout_sec = 0; // per game, 0 for none
+    size_t tt_size_mb = TT_DEFAULT_SIZE_MB;
+    bool use_symmetry = true;
+    bool region_keys = true; // file positions by their reachable region
+    bool mirror = false; // look for a mirroring strategy before searching
+    size_t threads = 1; // quiet runs only, 0 for one per hardware thread
+    MOVE_ORDER move_order = MOVE_ORDER::MOBILITY; // quiet runs
+    AAC_SOLVER aac_solver = AAC_SOLVER::MATCHING; // quiet runs only
+    MAC_SOLVER mac_solver = MAC_SOLVER::SEARCH; // single threaded quiet runs
+    std::filesystem::path results_dir = "Results"; // for loud runs
+    std::string tablebase;      // endgame tablebase to use, if any
+    std::string make_tablebase; // endgame tablebase to write, if any
+    uint32_t tb_edges = TB_DEFAULT_EDGES; // size of the one written
+    bool convert = false; // write graph files instead of playing anything
+    bool missing_paths = false; // some PATH didn't turn up any files
+} BATCH_OPTIONS;
+
+/****************************************************************************
+ * print_batch_usage
+ *
+ * - Prints the command line options to the given stream
+ *
+ * Parameters :
+ * - stream : where to print the usage message
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void print_batch_usage(FILE *__restrict stream) {
+    fprintf(stream,
+            "Usage: Cycle_Games [OPTIONS] PATH...\n"
+            "Plays games on each adjacency listing file given, without the "
+            "menus.\n"
+            "Each PATH can be a file, a directory (all .txt and " GRAPH_FILE_EXT
+            " files in it and\nits sub-directories), or a file name pattern "
+            "using * and ?. A graph file\n(" GRAPH_FILE_EXT ") is played on "
+            "in place of the text listing with the same name.\n"
+            "Graphs with more than %u nodes can only have quiet AAC games "
+            "played on them,\nwith --aac-solver matching.\n"
+            "With no arguments at all, the interactive menus are opened.\n\n"
+            "Options:\n"
+            "  -g, --games LIST    mac, aac, or mac,aac (default: mac,aac)\n"
+            "  -s, --starts LIST   starting nodes: all, or a comma separated "
+            "list of\n"
+            "                      nodes and ranges, e.g. 0,3,10-19 "
+            "(default: all)\n"
+            "  -o, --output MODE   quiet or loud (default: quiet). Loud runs "
+            "write their\n"
+            "                      progress to a file in the results "
+            "directory\n"
+            "  -t, --timeout SEC   give up on a game after SEC seconds, 0 for "
+            "no limit\n"
+            "                      (default: 0, quiet runs only). Anything "
+            "over 1e8 is\n"
+            "                      taken as no limit\n"
+            "      --tt MB         transposition table size, 0 to disable "
+            "(default: %d)\n"
+            "      --no-symmetry   don't use the graph's automorphisms to skip "
+            "equivalent\n"
+            "                      starting nodes/ positions\n"
+            "      --no-region-keys\n"
+            "                      file table positions by every visited node "
+            "instead of\n"
+            "                      just the part of the graph still "
+            "reachable\n"
+            "      --mirror        look for a mirroring strategy before "
+            "searching each\n"
+            "                      quiet game, and report the pairing if one "
+            "works\n"
+            "  -j, --threads N     search each quiet game with N threads, 0 "
+            "for one per\n"
+            "                      hardware thread (default: 1). More than one "
+            "thread\n"
+            "                      skips the transposition table, regions, "
+            "bridges,\n"
+            "                      chains and tablebase, so it usually searches "
+            "far\n"
+            "                      more positions than -j 1\n"
+            "      --order ORDER   move ordering for quiet runs: label, safe, "
+            "mobility,\n"
+            "                      or history (default: mobility)\n"
+            "      --aac-solver S  how quiet AAC games are solved: matching "
+            "(from a\n"
+            "                      maximum matching, no searching), search, "
+            "or both\n"
+            "                      (search, and check against the matching) "
+            "(default:\n"
+            "                      matching)\n"
+            "      --mac-solver S  how single threaded quiet MAC games are "
+            "solved:\n"
+            "                      search, or dfpn (proof number search, "
+            "with its own\n"
+            "                      table of --tt MB) (default: search)\n"
+            "      --results DIR   where loud runs write to (default: "
+            "./Results)\n"
+            "      --tablebase F   look small endgames up in the tablebase "
+            "file F\n"
+            "                      (single threaded quiet runs only)\n"
+            "      --make-tablebase F\n"
+            "                      write a tablebase to the file F before "
+            "playing\n"
+            "                      anything, PATHs are optional with this\n"
+            "      --tb-edges N    biggest endgames the written tablebase "
+            "covers, in\n"
+            "                      edges, at most %d (default: %d)\n"
+            "      --convert       write each text listing out as a graph "
+            "file (" GRAPH_FILE_EXT ")\n"
+            "                      next to it, which loads without any "
+            "parsing, instead\n"
+            "                      of playing on it\n"
+            "  -h, --help          show this message\n\n"
+            "Output: one JSON object per line on stdout for each game, e.g.\n"
+            "  {\"file\":\"GP (5,2).txt\",\"game\":\"MAC\",\"start\":0,"
+            "\"result\":\"LOSS\",\n"
+            "   \"winner\":\"P2\",\"time_ms\":0.01,\"nodes\":31,"
+            "\"solved_from\":0}\n"
+            "result is from P1's point of view: WIN, LOSS, TIMEOUT, or ERROR. "
+            "solved_from\nis the starting node that was actually played, which "
+            "differs from start\nwhen the result was copied over from a "
+            "symmetric starting node.\n\n"
+            "Exit codes: %d all games finished, %d some game timed out, %d "
+            "some file or\nstarting node couldn't be used, %d bad "
+            "arguments, %d the search and the\nmaximum matching disagreed "
+            "on an AAC game.\n",
+            (unsigned)ADJ_NARROW_MAX_NODES, TT_DEFAULT_SIZE_MB, TB_MAX_EDGES,
+            TB_DEFAULT_EDGES, BATCH_EXIT_OK, BATCH_EXIT_TIMEOUT,
+            BATCH_EXIT_BAD_INPUT, BATCH_EXIT_USAGE, BATCH_EXIT_MISMATCH);
+}
+
+/****************************************************************************
+ * wildcard_match
+ *
+ * - Lil helper function, checks a file name against a pattern where '*' matches
+ * any run of characters and '?' matches any single character
+ *
+ * Parameters :
+ * - pattern : the pattern
+ * - name : the file name to check
+ *
+ * Returns :
+ * - bool : whether the name matches the pattern
+ ****************************************************************************/
+bool wildcard_match(const std::string &__restrict pattern,
+                    const std::string &__restrict name) {
+    size_t p = 0, n = 0;
+    size_t star_p = std::string::npos, star_n = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() &&
+            (pattern[p] == '?' || pattern[p] == name[n])) {
+            p++;
+            n++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star_p = p++;
+            star_n = n;
+        } else if (star_p != std::string::npos) { // let the last * eat more
+            p = star_p + 1;
+            n = ++star_n;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+/****************************************************************************
+ * collect_batch_files
+ *
+ * - Turns one PATH argument into the adjacency listing files it refers to,
+ * appending them (sorted) to files_out
+ * - "_repaired" copies that older versions of the loader left next to files
+ * with Windows line endings are skipped when walking directories, since the
+ * originals load fine as they are
+ *
+ * Parameters :
+ * - arg : the command line argument
+ * - files_out : where the files are added
+ *
+ * Returns :
+ * - bool : false if the argument didn't refer to any files
+ ****************************************************************************/
+bool collect_batch_files(const std::string &__restrict arg,
+                         std::vector<std::filesystem::path> *__restrict
+                             files_out) {
+    const std::filesystem::path arg_path(arg);
+    std::vector<std::filesystem::path> found;
+    std::error_code err;
+
+    if (std::filesystem::is_directory(arg_path, err)) {
+        for (const auto &entry :
+             std::filesystem::recursive_directory_iterator(arg_path, err)) {
+            const std::string name = entry.path().filename().string();
+            const auto extension = entry.path().extension();
+            if (entry.is_regular_file() &&
+                (extension == ".txt" || extension == GRAPH_FILE_EXT) &&
+                name.find("_repaired") == std::string::npos) {
+                found.push_back(entry.path());
+            }
+        }
+    } else if (arg_path.filename().string().find_first_of("*?") !=
+               std::string::npos) {
+        std::filesystem::path parent = arg_path.parent_path();
+        if (parent.empty()) {
+            parent = ".";
+        }
+        const std::string pattern = arg_path.filename().string();
+        for (const auto &entry :
+             std::filesystem::directory_iterator(parent, err)) {
+            if (entry.is_regular_file() &&
+                wildcard_match(pattern, entry.path().filename().string())) {
+                found.push_back(entry.path());
+            }
+        }
+    } else if (std::filesystem::is_regular_file(arg_path, err)) {
+        found.push_back(arg_path);
+    }
+
+    std::sort(found.begin(), found.end());
+    files_out->insert(files_out->end(), found.begin(), found.end());
+    return !found.empty();
+}
+
+/****************************************************************************
+ * parse_start_list
+ *
+ * - Parses a starting node list like "0,3,10-19" (or "all")
+ *
+ * Parameters :
+ * - arg : the list as given on the command line
+ * - options : where the parsed list is stored
+ *
+ * Returns :
+ * - bool : false if the list is malformed
+ ****************************************************************************/
+bool parse_start_list(const std::string &__restrict arg,
+                      BATCH_OPTIONS *__restrict options) {
+    if (arg == "all") {
+        options->all_starts = true;
+        return true;
+    }
+
+    options->all_starts = false;
+    options->starts.clear();
+    size_t pos = 0;
+    while (pos <= arg.size()) {
+        size_t comma = arg.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = arg.size();
+        }
+        const std::string item = arg.substr(pos, comma - pos);
+        const size_t dash = item.find('-');
+        const std::string low_str = item.substr(0, dash);
+        const std::string high_str =
+            dash == std::string::npos ? low_str : item.substr(dash + 1);
+        if (!is_number(low_str) || !is_number(high_str) ||
+            low_str.size() > 10 || high_str.size() > 10) {
+            return false;
+        }
+        const unsigned long long low = std::stoull(low_str, NULL);
+        const unsigned long long high = std::stoull(high_str, NULL);
+        if (low > high || high >= ADJ_WIDE_MAX_NODES) {
+            return false;
+        }
+        for (unsigned long long node = low; node <= high; node++) {
+            options->starts.push_back((uint_fast32_t)node);
+        }
+        pos = comma + 1;
+    }
+
+    return !options->starts.empty();
+}
+
+/****************************************************************************
+ * parse_game_list
+ *
+ * - Parses the list of games to play, "mac", "aac", or both separated by a
+ * comma
+ *
+ * Parameters :
+ * - arg : the list as given on the command line
+ * - options : where the chosen games are stored
+ *
+ * Returns :
+ * - bool : false if the list is malformed
+ ****************************************************************************/
+bool parse_game_list(const std::string &__restrict arg,
+                     BATCH_OPTIONS *__restrict options) {
+    options->play_MAC = false;
+    options->play_AAC = false;
+    size_t pos = 0;
+    while (pos <= arg.size()) {
+        size_t comma = arg.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = arg.size();
+        }
+        const std::string item = arg.substr(pos, comma - pos);
+        if (item == "mac") {
+            options->play_MAC = true;
+        } else if (item == "aac") {
+            options->play_AAC = true;
+        } else {
+            return false;
+        }
+        pos = comma + 1;
+    }
+
+    return true;
+}
+
+/****************************************************************************
+ * parse_batch_args
+ *
+ * - Parses the command line into a BATCH_OPTIONS
+ *
+ * Parameters :
+ * - argc, argv : straight from main()
+ * - options : where the parsed options are stored
+ * - show_help_out : set to true if the user asked for the usage message
+ *
+ * Returns :
+ * - bool : false if the arguments were bad (a message has been printed)
+ ****************************************************************************/
+bool parse_batch_args(const int argc, char **argv,
+                      BATCH_OPTIONS *__restrict options,
+                      bool *__restrict show_help_out) {
+    *show_help_out = false;
+    bool any_paths = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        // every option other than the flags takes a value
+        const bool has_value = i + 1 < argc;
+        auto bad_value = [&arg]() {
+            fprintf(stderr, "Missing/ invalid value for %s\n", arg.c_str());
+            return false;
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            *show_help_out = true;
+            return true;
+        } else if (arg == "-g" || arg == "--games") {
+            if (!has_value || !parse_game_list(argv[++i], options)) {
+                return bad_value();
+            }
+        } else if (arg == "-s" || arg == "--starts") {
+            if (!has_value || !parse_start_list(argv[++i], options)) {
+                return bad_value();
+            }
+        } else if (arg == "-o" || arg == "--output") {
+            if (!has_value) {
+                return bad_value();
+            }
+            const std::string value = argv[++i];
+            if (value != "quiet" && value != "loud") {
+                return bad_value();
+            }
+            options->loud = value == "loud";
+        } else if (arg == "-t" || arg == "--timeout") {
+            char *end = NULL;
+            if (!has_value ||
+                !std::isfinite(options->timeout_sec =
+                                   std::strtod(argv[++i], &end)) ||
+                options->timeout_sec < 0 || end == argv[i] || *end != '\0') {
+                return bad_value();
+            }
+            if (options->timeout_sec > BATCH_MAX_TIMEOUT_SEC) {
+                options->timeout_sec = 0;
+            }
+        } else if (arg == "--tt") {
+            if (!has_value || !is_number(argv[++i]) ||
+                std::string(argv[i]).size() > 9) {
+                return bad_value();
+            }
+            options->tt_size_mb = std::stoul(argv[i], NULL);
+        } else if (arg == "-j" || arg == "--threads") {
+            if (!has_value || !is_number(argv[++i]) ||
+                std::string(argv[i]).size() > 4) {
+                return bad_value();
+            }
+            options->threads = std::stoul(argv[i], NULL);
+        } else if (arg == "--order") {
+            if (!has_value) {
+                return bad_value();
+            }
+            const std::string value = argv[++i];
+            size_t order = 0;
+            while (order < (size_t)MOVE_ORDER::NUM_ORDERS &&
+                   value != MOVE_ORDER_NAMES[order]) {
+                order++;
+            }
+            if (order == (size_t)MOVE_ORDER::NUM_ORDERS) {
+                return bad_value();
+            }
+            options->move_order = (MOVE_ORDER)order;
+        } else if (arg == "--aac-solver") {
+            if (!has_value) {
+                return bad_value();
+            }
+            const std::string value = argv[++i];
+            size_t solver = 0;
+            while (solver < (size_t)AAC_SOLVER::NUM_SOLVERS &&
+                   value != AAC_SOLVER_NAMES[solver]) {
+                solver++;
+            }
+            if (solver == (size_t)AAC_SOLVER::NUM_SOLVERS) {
+                return bad_value();
+            }
+            options->aac_solver = (AAC_SOLVER)solver;
+        } else if (arg == "--mac-solver") {
+            if (!has_value) {
+                return bad_value();
+            }
+            const std::string value = argv[++i];
+            size_t solver = 0;
+            while (solver < (size_t)MAC_SOLVER::NUM_SOLVERS &&
+                   value != MAC_SOLVER_NAMES[solver]) {
+                solver++;
+            }
+            if (solver == (size_t)MAC_SOLVER::NUM_SOLVERS) {
+                return bad_value();
+            }
+            options->mac_solver = (MAC_SOLVER)solver;
+        } else if (arg == "--no-symmetry") {
+            options->use_symmetry = false;
+        } else if (arg == "--no-region-keys") {
+            options->region_keys = false;
+        } else if (arg == "--mirror") {
+            options->mirror = true;
+        } else if (arg == "--convert") {
+            options->convert = true;
+        } else if (arg == "--results") {
+            if (!has_value) {
+                return bad_value();
+            }
+            options->results_dir = argv[++i];
+        } else if (arg == "--tablebase") {
+            if (!has_value) {
+                return bad_value();
+            }
+            options->tablebase = argv[++i];
+        } else if (arg == "--make-tablebase") {
+            if (!has_value) {
+                return bad_value();
+            }
+            options->make_tablebase = argv[++i];
+        } else if (arg == "--tb-edges") {
+            if (!has_value || !is_number(argv[++i]) ||
+                std::string(argv[i]).size() > 2 ||
+                std::stoul(argv[i], NULL) > TB_MAX_EDGES) {
+                return bad_value();
+            }
+            options->tb_edges = (uint32_t)std::stoul(argv[i], NULL);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        } else {
+            any_paths = true;
+            if (!collect_batch_files(arg, &options->files)) {
+                fprintf(stderr, "No files found for \"%s\"\n", arg.c_str());
+                options->missing_paths = true;
+            }
+        }
+    }
+
+    if (!any_paths && options->make_tablebase.empty()) {
+        fprintf(stderr, "No adjacency listing files given\n");
+        return false;
+    }
+    return true;
+}
+
+/****************************************************************************
+ * json_escape
+ *
+ * - Lil helper function, escapes a string for use inside a JSON string
+ *
+ * Parameters :
+ * - input : the string to escape
+ *
+ * Returns :
+ * - std::string : the escaped string (without the surrounding quotes)
+ ****************************************************************************/
+std::string json_escape(const std::string &__restrict input) {
+    std::string output;
+    output.reserve(input.size());
+    for (const char c : input) {
+        if (c == '"' || c == '\\') {
+            output.push_back('\\');
+            output.push_back(c);
+        } else if ((unsigned char)c < 0x20) {
+            char buff[8];
+            snprintf(buff, sizeof(buff), "\\u%04x", (unsigned)c);
+            output.append(buff);
+        } else {
+            output.push_back(c);
+        }
+    }
+    return output;
+}
+
+// One line of output
+typedef struct BATCH_RESULT {
+    std::string file;
+    const char *game = "MAC";
+    int_fast64_t start = -1; // -1 if the error isn't about a particular node
+    const char *result = "ERROR";
+    double time_ms = 0;
+    int_fast64_t nodes = -1; // -1 if not counted (loud runs)
+    int_fast64_t solved_from = -1;
+    const MIRROR_STRATEGY *mirror = NULL; // set if one settled the game
+    std::string error;
+} BATCH_RESULT;
+
+/****************************************************************************
+ * print_batch_result
+ *
+ * - Writes one result to stdout as a line of JSON, and flushes it right away
+ * so that whoever's reading gets it as soon as possible
+ *
+ * Parameters :
+ * - result : the result to write
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void print_batch_result(const BATCH_RESULT &__restrict result) {
+    const bool finished = std::strcmp(result.result, "WIN") == 0 ||
+                          std::strcmp(result.result, "LOSS") == 0;
+    printf("{\"file\":\"%s\",\"game\":\"%s\"", json_escape(result.file).c_str(),
+           result.game);
+    if (result.start >= 0) {
+        printf(",\"start\":%lld", (long long)result.start);
+    }
+    printf(",\"result\":\"%s\"", result.result);
+    if (finished) {
+        printf(",\"winner\":\"%s\"",
+               std::strcmp(result.result, "WIN") == 0 ? "P1" : "P2");
+    }
+    printf(",\"time_ms\":%.3f", result.time_ms);
+    if (result.nodes >= 0) {
+        printf(",\"nodes\":%lld", (long long)result.nodes);
+    }
+    if (result.solved_from >= 0) {
+        printf(",\"solved_from\":%lld", (long long)result.solved_from);
+    }
+    if (result.mirror != NULL) {
+        const bool p1_mirrors = result.mirror->opening != MIRROR_NO_OPENING;
+        printf(",\"mirror\":{\"player\":\"%s\"", p1_mirrors ? "P1" : "P2");
+        if (p1_mirrors) {
+            printf(",\"opening\":%u", (unsigned)result.mirror->opening);
+        }
+        printf(",\"involution\":[");
+        for (size_t node = 0; node < result.mirror->involution.size(); node++) {
+            printf("%s%u", node > 0 ? "," : "",
+                   (unsigned)result.mirror->involution[node]);
+        }
+        printf("]}");
+    }
+    if (!result.error.empty()) {
+        printf(",\"error\":\"%s\"", json_escape(result.error).c_str());
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+/****************************************************************************
+ * game_deadline
+ *
+ * - Works out when a game started at start_time runs out of time
+ *
+ * Parameters :
+ * - start_time : when the game started
+ * - timeout_sec : the timeout, which should be more than 0 (the deadline
+ * isn't used otherwise)
+ *
+ * Returns :
+ * - std::chrono::steady_clock::time_point : the game's deadline
+ ****************************************************************************/
+inline std::chrono::steady_clock::time_point
+game_deadline(const std::chrono::steady_clock::time_point start_time,
+              const double timeout_sec) {
+    return start_time +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double>(
+                   std::min(timeout_sec, BATCH_MAX_TIMEOUT_SEC)));
+}
+
+/****************************************************************************
+ * batch_play_loud
+ *
+ * - Plays one loud game for the batch mode, writing its progress to the usual
+ * result file name inside the results directory
+ *
+ * Parameters :
+ * - file : the adjacency listing file the graph came from
+ * - graph : the graph
+ * - play_MAC : true to play MAC, false to play AAC
+ * - start : the starting node
+ * - results_dir : the directory to write the result file to
+ * - error_out : set to a description of what went wrong, if anything
+ *
+ * Returns :
+ * - GAME_STATE : the game's result, or KILL_STATE if the file couldn't be
+ * opened
+ ****************************************************************************/
+GAME_STATE batch_play_loud(const std::filesystem::path &__restrict file,
+                           const ADJACENCY_CSR &__restrict graph,
+                           const bool play_MAC, const uint_fast16_t start,
+                           const std::filesystem::path &__restrict results_dir,
+                           std::string *__restrict error_out) {
+    std::filesystem::path result_path = results_dir;
+    result_path.append(get_result_file_name(file, play_MAC ? 0 : 1, start));
+
+    FILE *result_stream = NULL;
+#ifdef _WIN32
+    fopen_s(&result_stream, result_path.string().c_str(), "w");
+#else
+    result_stream = fopen(result_path.string().c_str(), "w");
+#endif // _WIN32
+    if (result_stream == NULL) [[unlikely]] {
+        *error_out = "failed to open result file " + result_path.string();
+        return GAME_STATE::KILL_STATE;
+    }
+
+    PACKED_STATES<EDGE_STATE> edge_use_list(graph.num_edges);
+    PACKED_STATES<NODE_STATE> node_use_list(graph.num_nodes);
+    std::vector<uint_fast16_t> move_hist(graph.num_nodes);
+    node_use_list.set(start, NODE_STATE::USED);
+    const GAME_STATE result =
+        play_MAC ? play_MAC_loud(start, graph, edge_use_list, node_use_list,
+                                 move_hist, 0, result_stream)
+                 : play_AAC_loud(start, graph, edge_use_list, node_use_list,
+                                 move_hist, 0, result_stream);
+    fclose(result_stream);
+
+    return result;
+}
+
+/****************************************************************************
+ * prefer_graph_files
+ *
+ * - Drops the text listings that have a graph file of the same name in the
+ * list too, so each graph is only played on once, from the file that loads
+ * faster
+ *
+ * Parameters :
+ * - files : the files to play on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void prefer_graph_files(std::vector<std::filesystem::path> *__restrict files) {
+    std::vector<std::filesystem::path> graph_files;
+    for (const std::filesystem::path &file : *files) {
+        if (file.extension() == GRAPH_FILE_EXT) {
+            graph_files.push_back(file);
+        }
+    }
+    if (graph_files.empty()) {
+        return;
+    }
+    std::sort(graph_files.begin(), graph_files.end());
+    files->erase(std::remove_if(files->begin(), files->end(),
+                                [&graph_files](std::filesystem::path file) {
+                                    if (file.extension() == GRAPH_FILE_EXT) {
+                                        return false;
+                                    }
+                                    file.replace_extension(GRAPH_FILE_EXT);
+                                    return std::binary_search(
+                                        graph_files.begin(), graph_files.end(),
+                                        file);
+                                }),
+                 files->end());
+}
+
+/****************************************************************************
+ * batch_convert
+ *
+ * - Writes each text listing given out as a graph file next to it
+ * (--convert), reporting each one written to stderr
+ *
+ * Parameters :
+ * - options : the parsed command line
+ *
+ * Returns :
+ * - int : the program's exit code (BATCH_EXIT_*)
+ ****************************************************************************/
+int batch_convert(const BATCH_OPTIONS &__restrict options) {
+    int exit_code =
+        options.missing_paths ? BATCH_EXIT_BAD_INPUT : BATCH_EXIT_OK;
+    for (const std::filesystem::path &file : options.files) {
+        if (file.extension() == GRAPH_FILE_EXT) {
+            continue;
+        }
+        std::filesystem::path graph_path;
+        if (!convert_adjacency_file(file, &graph_path)) [[unlikely]] {
+            fprintf(stderr, "Couldn't convert %s\n", file.string().c_str());
+            exit_code = BATCH_EXIT_BAD_INPUT;
+            continue;
+        }
+        fprintf(stderr, "Wrote %s\n", graph_path.string().c_str());
+    }
+    return exit_code;
+}
+
+/****************************************************************************
+ * batch_main
+ *
+ * - Entry point for the command line mode (see the top of this file)
+ *
+ * Parameters :
+ * - argc, argv : straight from main()
+ *
+ * Returns :
+ * - int : the program's exit code (BATCH_EXIT_*)
+ ****************************************************************************/
+int batch_main(const int argc, char **argv) {
+    headless_mode = true;
+
+    BATCH_OPTIONS options;
+    bool show_help = false;
+    if (!parse_batch_args(argc, argv, &options, &show_help)) {
+        fprintf(stderr, "Run with --help for usage\n");
+        return BATCH_EXIT_USAGE;
+    }
+    if (show_help) {
+        print_batch_usage(stdout);
+        return BATCH_EXIT_OK;
+    }
+    if (options.loud) {
+        std::error_code err;
+        std::filesystem::create_directories(options.results_dir, err);
+        if (!std::filesystem::is_directory(options.results_dir)) {
+            fprintf(stderr, "Couldn't create the results directory: %s\n",
+                    options.results_dir.string().c_str());
+            return BATCH_EXIT_USAGE;
+        }
+    }
+    if (!options.make_tablebase.empty()) {
+        if (!make_tablebase(options.make_tablebase.c_str(), options.tb_edges)) {
+            fprintf(stderr, "Couldn't write the tablebase: %s\n",
+                    options.make_tablebase.c_str());
+            return BATCH_EXIT_USAGE;
+        }
+        if (options.files.empty() && !options.missing_paths) {
+            return BATCH_EXIT_OK;
+        }
+    }
+    if (options.convert) {
+        return batch_convert(options);
+    }
+    prefer_graph_files(&options.files);
+    TABLEBASE tablebase;
+    if (!options.tablebase.empty() &&
+        !load_tablebase(options.tablebase.c_str(), &tablebase)) {
+        fprintf(stderr, "Couldn't load the tablebase: %s\n",
+                options.tablebase.c_str());
+        return BATCH_EXIT_USAGE;
+    }
+
+    int exit_code =
+        options.missing_paths ? BATCH_EXIT_BAD_INPUT : BATCH_EXIT_OK;
+    size_t num_played = 0, num_copied = 0, num_timeouts = 0, num_errors = 0;
+    auto note_exit = [&exit_code](const int code) {
+        exit_code = std::max(exit_code, code);
+    };
+
+    // the threads are kept around for every game in the run
+    std::unique_ptr<ThreadPool> pool;
+    if (!options.loud && options.threads != 1) {
+        pool = std::make_unique<ThreadPool>(options.threads);
+    }
+
+    for (const std::filesystem::path &file : options.files) {
+        BATCH_RESULT base;
+        base.file = file.string();
+
+        bool load_success = false;
+        const ANY_ADJACENCY_CSR loaded_graph = load_graph(file, &load_success);
+        if (!load_success || graph_num_nodes(loaded_graph) == 0) [[unlikely]] {
+            base.error = "failed to load adjacency information";
+            print_batch_result(base);
+            num_errors++;
+            note_exit(BATCH_EXIT_BAD_INPUT);
+            continue;
+        }
+
+        std::vector<uint_fast32_t> starts = options.starts;
+        if (options.all_starts) {
+            starts.resize(graph_num_nodes(loaded_graph));
+            for (uint_fast32_t node = 0; node < starts.size(); node++) {
+                starts[node] = node;
+            }
+        }
+
+        // graphs too big for 16 bit node labels can't be searched, but AAC
+        // can still be solved on them from a maximum matching
+        if (const WIDE_ADJACENCY_CSR *wide_graph =
+                std::get_if<WIDE_ADJACENCY_CSR>(&loaded_graph)) {
+            for (const bool play_MAC : {true, false}) {
+                if ((play_MAC && !options.play_MAC) ||
+                    (!play_MAC && !options.play_AAC)) {
+                    continue;
+                }
+                BATCH_RESULT result = base;
+                result.game = play_MAC ? "MAC" : "AAC";
+                if (play_MAC || options.loud ||
+                    options.aac_solver != AAC_SOLVER::MATCHING) {
+                    result.error = "graph has too many nodes to search, only "
+                                   "quiet AAC games with --aac-solver "
+                                   "matching can be played on it";
+                    print_batch_result(result);
+                    num_errors++;
+                    note_exit(BATCH_EXIT_BAD_INPUT);
+                    continue;
+                }
+
+                const auto start_time = std::chrono::steady_clock::now();
+                std::vector<GAME_STATE> matching_results;
+                play_AAC_matching(*wide_graph, &matching_results);
+                // the matching answers every start at once, so it all gets
+                // charged to the first game
+                result.time_ms = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() -
+                                     start_time)
+                                     .count();
+                for (const uint_fast32_t start : starts) {
+                    BATCH_RESULT start_result = result;
+                    start_result.start = start;
+                    if (start >= wide_graph->num_nodes) [[unlikely]] {
+                        start_result.error = "starting node out of range";
+                        print_batch_result(start_result);
+                        num_errors++;
+                        note_exit(BATCH_EXIT_BAD_INPUT);
+                        continue;
+                    }
+                    start_result.result =
+                        matching_results[start] == GAME_STATE::WIN_STATE
+                            ? "WIN"
+                            : "LOSS";
+                    start_result.nodes = 0;
+                    start_result.solved_from = start;
+                    print_batch_result(start_result);
+                    result.time_ms = 0;
+                    num_played++;
+                }
+            }
+            continue;
+        }
+        const ADJACENCY_CSR &graph = std::get<ADJACENCY_CSR>(loaded_graph);
+        const uint_fast16_t num_nodes = graph.num_nodes;
+
+        // the pieces that don't depend on the game being played
+        AUTOMORPHISM_GROUP symmetry;
+        std::vector<uint16_t> orbit_rep(num_nodes);
+        for (uint_fast16_t node = 0; node < num_nodes; node++) {
+            orbit_rep[node] = (uint16_t)node;
+        }
+        if (options.use_symmetry || options.mirror) {
+            find_automorphisms(graph, &symmetry);
+        }
+        if (options.use_symmetry) {
+            orbit_rep = find_orbits(symmetry);
+        }
+        GRAPH_BRIDGES bridges;
+        find_bridges(graph, &bridges);
+        SERIES_CHAINS series;
+        find_series_chains(graph, &series);
+        ZOBRIST_KEYS zobrist;
+        TRANSPOSITION_TABLE table;
+        const bool use_table = !options.loud && options.tt_size_mb > 0 &&
+                               tt_init(&table, options.tt_size_mb, num_nodes);
+        // df-pn keeps its own table, in place of the transposition table
+        PN_TABLE pn_table;
+        const bool use_dfpn = !options.loud && options.threads == 1 &&
+                              options.play_MAC &&
+                              options.mac_solver == MAC_SOLVER::DFPN &&
+                              pn_init(&pn_table, options.tt_size_mb, num_nodes);
+        if (use_table || use_dfpn) {
+            zobrist = zobrist_init(num_nodes);
+        }
+
+        for (const bool play_MAC : {true, false}) {
+            if ((play_MAC && !options.play_MAC) ||
+                (!play_MAC && !options.play_AAC)) {
+                continue;
+            }
+            base.game = play_MAC ? "MAC" : "AAC";
+
+            // table entries are only good for the game they were found in
+            if (use_table) {
+                tt_clear(&table);
+            }
+            SEARCH_CONTEXT context;
+            init_search_context(&context, &zobrist, use_table ? &table : NULL,
+                                options.use_symmetry ? &symmetry : NULL, 0);
+            set_move_order(&context, options.move_order, num_nodes);
+            set_bridges(&context, graph, &bridges);
+            set_series_chains(&context, &series);
+            if (options.region_keys) {
+                set_region_keys(&context, graph);
+            }
+            if (tablebase.entries != NULL) {
+                set_tablebase(&context, num_nodes, &tablebase);
+            }
+            // results of the games played so far, by orbit. Once an orbit's
+            // game times out, the rest of the orbit would too
+            std::vector<GAME_STATE> orbit_result(num_nodes,
+                                                 GAME_STATE::KILL_STATE);
+            std::vector<uint_fast16_t> orbit_solver(num_nodes);
+            std::vector<bool> orbit_timed_out(num_nodes, false);
+            // AAC results for every start at once, found along with the first
+            // game that needs them (see play_AAC_matching)
+            const bool use_matching = !play_MAC && !options.loud &&
+                                      options.aac_solver != AAC_SOLVER::SEARCH;
+            std::vector<GAME_STATE> matching_results;
+
+            for (const uint_fast32_t start : starts) {
+                BATCH_RESULT result = base;
+                result.start = start;
+                if (start >= num_nodes) [[unlikely]] {
+                    result.error = "starting node out of range";
+                    print_batch_result(result);
+                    num_errors++;
+                    note_exit(BATCH_EXIT_BAD_INPUT);
+                    continue;
+                }
+
+                const uint16_t rep = orbit_rep[start];
+                if (orbit_result[rep] != GAME_STATE::KILL_STATE) {
+                    result.result = orbit_result[rep] == GAME_STATE::WIN_STATE
+                                        ? "WIN"
+                                        : "LOSS";
+                    result.nodes = 0;
+                    result.solved_from = orbit_solver[rep];
+                    print_batch_result(result);
+                    num_copied++;
+                    continue;
+                } else if (orbit_timed_out[rep]) {
+                    result.result = "TIMEOUT";
+                    result.nodes = 0;
+                    result.solved_from = orbit_solver[rep];
+                    print_batch_result(result);
+                    num_timeouts++;
+                    continue;
+                }
+
+                GAME_STATE game_result;
+                MIRROR_STRATEGY mirror;
+                const auto start_time = std::chrono::steady_clock::now();
+                if (use_matching && matching_results.empty()) {
+                    play_AAC_matching(graph, &matching_results);
+                }
+                if (use_matching &&
+                    options.aac_solver == AAC_SOLVER::MATCHING) {
+                    game_result = matching_results[start];
+                    result.nodes = 0;
+                } else if (options.mirror && !options.loud &&
+                           find_mirror_strategy(graph, symmetry, play_MAC,
+                                                start, &mirror)) {
+                    game_result = mirror.result;
+                    result.nodes = (int_fast64_t)mirror.positions;
+                    result.mirror = &mirror;
+                } else if (options.loud) {
+                    game_result =
+                        batch_play_loud(file, graph, play_MAC, start,
+                                        options.results_dir, &result.error);
+                } else if (options.threads != 1) {
+                    const auto deadline =
+                        game_deadline(start_time, options.timeout_sec);
+                    PARALLEL_STATS stats;
+                    game_result =
+                        play_MAC
+                            ? play_MAC_threaded(
+                                  start, graph, *pool, options.move_order,
+                                  options.timeout_sec > 0 ? &deadline : NULL,
+                                  &stats)
+                            : play_AAC_threaded(
+                                  start, graph, *pool, options.move_order,
+                                  options.timeout_sec > 0 ? &deadline : NULL,
+                                  &stats);
+                    result.nodes = (int_fast64_t)stats.nodes;
+                } else if (play_MAC && use_dfpn) {
+                    PACKED_STATES<EDGE_STATE> edge_use_list(graph.num_edges);
+                    PACKED_STATES<NODE_STATE> node_use_list(num_nodes);
+                    node_use_list.set(start, NODE_STATE::USED);
+
+                    DFPN_CONTEXT dfpn_context;
+                    init_dfpn_context(&dfpn_context, &zobrist, &pn_table,
+                                      start);
+                    dfpn_context.has_deadline = options.timeout_sec > 0;
+                    dfpn_context.deadline =
+                        game_deadline(start_time, options.timeout_sec);
+                    game_result = play_MAC_dfpn(start, graph, edge_use_list,
+                                                node_use_list, dfpn_context);
+                    result.nodes = (int_fast64_t)dfpn_context.nodes;
+                } else {
+                    PACKED_STATES<EDGE_STATE> edge_use_list(graph.num_edges);
+                    PACKED_STATES<NODE_STATE> node_use_list(num_nodes);
+                    node_use_list.set(start, NODE_STATE::USED);
+
+                    restart_search_context(&context, start);
+                    context.has_deadline = options.timeout_sec > 0;
+                    context.deadline =
+                        game_deadline(start_time, options.timeout_sec);
+                    const uint64_t start_nodes = context.nodes;
+                    game_result =
+                        play_MAC
+                            ? play_MAC_iterative(start, graph, edge_use_list,
+                                                 node_use_list, context)
+                            : play_AAC_iterative(start, graph, edge_use_list,
+                                                 node_use_list, context);
+                    result.nodes = (int_fast64_t)(context.nodes - start_nodes);
+                }
+                result.time_ms = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() -
+                                     start_time)
+                                     .count();
+
+                if (game_result == GAME_STATE::KILL_STATE) {
+                    if (result.error.empty()) {
+                        result.result = "TIMEOUT";
+                        result.solved_from = start;
+                        orbit_timed_out[rep] = true;
+                        orbit_solver[rep] = start;
+                        num_timeouts++;
+                        note_exit(BATCH_EXIT_TIMEOUT);
+                    } else {
+                        num_errors++;
+                        note_exit(BATCH_EXIT_BAD_INPUT);
+                    }
+                } else {
+                    result.result =
+                        game_result == GAME_STATE::WIN_STATE ? "WIN" : "LOSS";
+                    result.solved_from = start;
+                    orbit_result[rep] = game_result;
+                    orbit_solver[rep] = start;
+                    num_played++;
+                    if (options.aac_solver == AAC_SOLVER::BOTH &&
+                        use_matching &&
+                        game_result != matching_results[start]) [[unlikely]] {
+                        result.error = "the search and the maximum matching "
+                                       "disagree";
+                        num_errors++;
+                        note_exit(BATCH_EXIT_MISMATCH);
+                    }
+                }
+                print_batch_result(result);
+            }
+        }
+    }
+
+    fprintf(stderr,
+            "%zu file(s): %zu game(s) played, %zu copied from a symmetric "
+            "starting node, %zu timed out, %zu error(s)\n",
+            options.files.size(), num_played, num_copied, num_timeouts,
+            num_errors);
+    close_tablebase(&tablebase);
+    return exit_code;
+}
@@ -0,0 +1,118 @@
+#pragma once
+/*
+ *
+ * - This file holds the code for finding a graph's bridges (edges that aren't
+ * on any cycle) and cut nodes (nodes whose removal splits up their connected
+ * component), worked out once right after the graph is loaded
+ * - Both come out of the same depth first search (Tarjan, 1974): every node
+ * gets the time it was first reached, and the earliest time reachable from
+ * its subtree of the search tree using at most one edge that isn't in the
+ * tree ("low"). A tree edge down to child is a bridge exactly when child's
+ * low is later than its parent's time, and a non root node is a cut node
+ * exactly when one of its children's low isn't earlier than its own time
+ * - Why the games care: a path can only cross a bridge once, so as soon as a
+ * move crosses one everything on the far side is still unvisited, and none of
+ * it touches anything on the near side except through the (now used) bridge.
+ * The rest of the game is then just the game on the far side started from the
+ * node the bridge leads to, no matter how the game got there (see
+ * set_bridges in Cycle_Games.h)
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+
+typedef struct GRAPH_BRIDGES {
+    std::vector<bool> is_bridge;   // by edge ID
+    std::vector<bool> is_cut_node; // by node
+    uint32_t num_bridges = 0;
+    uint32_t num_cut_nodes = 0;
+} GRAPH_BRIDGES;
+
+/****************************************************************************
+ * find_bridges
+ *
+ * - Finds every bridge and cut node of a graph
+ * - The depth first search runs off an explicit stack rather than recursion,
+ * since a long path through a big graph would run the thread out of stack
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph in question
+ * - bridges_out : where the results are written
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void find_bridges(const ADJACENCY_CSR &__restrict graph,
+                  GRAPH_BRIDGES *__restrict bridges_out) {
+    const uint_fast16_t num_nodes = graph.num_nodes;
+    std::vector<uint32_t> reached_at(num_nodes, 0); // 0 == not reached yet
+    std::vector<uint32_t> low(num_nodes, 0);
+    std::vector<uint32_t> parent_edge(num_nodes, UINT32_MAX);
+    std::vector<uint32_t> next_adj(num_nodes, 0); // CSR index to look at next
+    std::vector<uint16_t> stack;
+    stack.reserve(num_nodes);
+    uint32_t time = 0;
+
+    bridges_out->is_bridge.assign(graph.num_edges, false);
+    bridges_out->is_cut_node.assign(num_nodes, false);
+    bridges_out->num_bridges = 0;
+    bridges_out->num_cut_nodes = 0;
+
+    for (uint_fast16_t root = 0; root < num_nodes; root++) {
+        if (reached_at[root] != 0) {
+            continue;
+        }
+        uint32_t root_children = 0;
+        reached_at[root] = low[root] = ++time;
+        next_adj[root] = graph.offsets[root];
+        stack.push_back((uint16_t)root);
+
+        while (!stack.empty()) {
+            const uint16_t node = stack.back();
+            if (next_adj[node] < graph.offsets[node + 1]) {
+                const uint32_t adj_index = next_adj[node]++;
+                const uint16_t neighbor = graph.neighbors[adj_index];
+                const uint32_t edge = graph.edge_ids[adj_index];
+                if (edge == parent_edge[node]) {
+                    continue;
+                }
+                if (reached_at[neighbor] == 0) { // tree edge, go down it
+                    parent_edge[neighbor] = edge;
+                    reached_at[neighbor] = low[neighbor] = ++time;
+                    next_adj[neighbor] = graph.offsets[neighbor];
+                    stack.push_back(neighbor);
+                    root_children += node == root ? 1 : 0;
+                } else {
+                    low[node] = std::min(low[node], reached_at[neighbor]);
+                }
+                continue;
+            }
+
+            // done with node's subtree, hand its low up to its parent
+            stack.pop_back();
+            if (stack.empty()) {
+                break;
+            }
+            const uint16_t parent = stack.back();
+            low[parent] = std::min(low[parent], low[node]);
+            if (low[node] > reached_at[parent]) {
+                bridges_out->is_bridge[parent_edge[node]] = true;
+                bridges_out->num_bridges++;
+            }
+            if (parent != root && low[node] >= reached_at[parent] &&
+                !bridges_out->is_cut_node[parent]) {
+                bridges_out->is_cut_node[parent] = true;
+                bridges_out->num_cut_nodes++;
+            }
+        }
+
+        if (root_children > 1) {
+            bridges_out->is_cut_node[root] = true;
+            bridges_out->num_cut_nodes++;
+        }
+    }
+}
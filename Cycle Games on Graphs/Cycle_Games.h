@@ -26,6 +26,7 @@
 
 #pragma once
 #include <cassert>
+#include <chrono>
 #include <cstdarg>
 #include <cstdint>
 #include <cstring> // needed for memset
@@ -34,23 +35,832 @@
 #include <vector>
 
 #include "Adjacency_Matrix.h"
+#include "Automorphism.h"
+#include "Bridges.h"
+#include "Matching.h"
+#include "Packed_State.h"
+#include "Series.h"
+#include "Tablebase.h"
+#include "Transposition_Table.h"
 
 enum class GAME_STATE : uint_fast16_t { WIN_STATE, LOSS_STATE, KILL_STATE };
 
 // Keeping these as separate enum classes for now, in case we want to expand one
 // of them separately later...
-enum class EDGE_STATE : uint_fast16_t { NOT_USED, USED };
-enum class NODE_STATE : uint_fast16_t { NOT_USED, USED };
+// - The edge and node use lists store these one bit per entry (see
+// Packed_State.h), so NOT_USED has to stay 0 and USED has to stay 1
+enum class EDGE_STATE : uint8_t { NOT_USED, USED };
+enum class NODE_STATE : uint8_t { NOT_USED, USED };
 
-// since we're using an adjacency matrix internally, this involves marking two
-// entries every time a move is done/undone along a single edge instead of
-// explicitly marking adj_matr[i,j] and adj[j,i] in the code, we'll do both with
-// this macro for the sake of readability
-#define MARK_EDGE(arr, num_nodes, node_1, node_2, edge_val)                    \
-    do {                                                                       \
-        arr[index_translation(num_nodes, node_1, node_2)] = edge_val;          \
-        arr[index_translation(num_nodes, node_2, node_1)] = edge_val;          \
-    } while (false)
+// Edges are tracked by their ID in the graph's CSR form (see
+// Adjacency_Matrix.h), so doing/ undoing a move along an edge is a single write
+// into the edge use list
+
+/*
+ *
+ * - The quiet game playing functions carry the following struct along with
+ * them through the recursion. It holds the (optional) transposition table, the
+ * current position's Zobrist hash, and counters for the final report
+ * - If table is NULL, the hash isn't maintained and nothing is looked up
+ * - The table is only used for the first table_plies moves of the game. Deeper
+ * than that the subtrees are small enough that a (almost always missing)
+ * trip out to main memory costs more than just searching them again
+ * - The table's key is the current node plus the set of visited nodes (see
+ * Transposition_Table.h for why that's enough)
+ * - If has_deadline is set, the game gives up once the deadline passes and
+ * returns KILL_STATE all the way back up. Nothing from an abandoned game makes
+ * it into the table
+ * - If symmetry is also set, positions in the first canon_plies moves of the
+ * game are put into canonical form under the graph's automorphisms before
+ * going into/ coming out of the table (see Automorphism.h). That's where the
+ * branching is highest and the symmetric copies are most common, and it's
+ * only worth paying the cost of running through the group there
+ * - If bridges is set (see set_bridges), the result of every move across a
+ * bridge is saved the first time it's searched, and looked up from then on
+ * - If tablebase is set (see set_tablebase), positions whose residual graph is
+ * small enough are looked up in it instead of searched
+ * - If series is set (see set_series_chains), chains of degree 2 nodes are
+ * taken in a single move
+ * - If use_regions is set (see set_region_keys), positions are filed in the
+ * table by the part of the graph the game can still get to
+ *
+ */
+// Default number of moves into the game that positions are canonicalized for
+#define SYMMETRY_CANON_PLIES 4
+// How often (in positions searched, minus 1, power of 2) to check the clock
+// when a game has a deadline
+#define SEARCH_CLOCK_MASK 0x3FFF
+// The table is used for the first (number of nodes / TT_DEPTH_FRACTION) moves
+#define TT_DEPTH_FRACTION 3
+// History scores are halved across the board once one of them gets this big
+#define HISTORY_SCORE_LIMIT (1U << 30)
+
+// The order the iterative search tries a position's moves in (see
+// order_moves). Every order gives the same result, they only differ in how
+// soon a winning move turns up, and so how much gets searched
+enum class MOVE_ORDER : uint8_t {
+    LABEL,      // neighbors in label order, same as the recursive versions
+    SAFE_FIRST, // moves that hand the opponent an immediate win go last
+                // (MAC), moves that leave them stuck go first (AAC)
+    MOBILITY,   // fewest replies for the opponent first
+    HISTORY,    // moves that have won the most before first (history
+                // heuristic), with the last winning move at the same depth
+                // (killer move) ahead of the rest
+    NUM_ORDERS
+};
+inline constexpr const char *MOVE_ORDER_NAMES[] = {"label", "safe", "mobility",
+                                                   "history"};
+
+// How AAC games get solved (see play_AAC_matching)
+enum class AAC_SOLVER : uint8_t {
+    MATCHING, // straight from a maximum matching, no searching
+    SEARCH,   // the same search as MAC
+    BOTH,     // search, and check the result against the matching
+    NUM_SOLVERS
+};
+inline constexpr const char *AAC_SOLVER_NAMES[] = {"matching", "search",
+                                                   "both"};
+
+// How quiet MAC games get solved (see play_MAC_dfpn in Cycle_Games_DFPN.h)
+enum class MAC_SOLVER : uint8_t {
+    SEARCH, // the iterative search
+    DFPN,   // depth first proof number search
+    NUM_SOLVERS
+};
+inline constexpr const char *MAC_SOLVER_NAMES[] = {"search", "dfpn"};
+
+// One ply of the iterative search (see play_quiet_iterative): the position's
+// current node, the move that got there, and how far through the node's
+// moves the search has gotten
+typedef struct SEARCH_FRAME {
+    uint16_t node = 0;
+    uint32_t edge = 0;      // edge moved along to get to node
+    uint32_t adj_index = 0; // CSR index of the next move to try from node
+    uint64_t move_key = 0;  // Zobrist key of the move to node
+    bool probed = false;    // the table was checked (and missed) at entry
+    uint32_t key_node = 0;  // the position's table key, if probed
+    uint64_t key_hash = 0;
+    const uint64_t *key_words = NULL;
+    uint64_t start_nodes = 0; // context.nodes when the search here started
+    bool ordered = false;     // moves come from move_stack instead of the CSR
+    uint32_t move_begin = 0;  // the position's move_stack entries, if ordered
+    uint32_t move_next = 0;   // next move_stack entry to try, if ordered
+    uint32_t move_end = 0;    // end of the position's move_stack entries
+    uint32_t last_adj = 0;    // CSR index of the move tried most recently
+    uint32_t tried = 0;       // number of moves tried so far
+    bool across_bridge = false; // the move to node crossed a bridge
+    bool small_residual = false; // the residual graph fits in the tablebase
+    uint32_t chain = SERIES_NONE; // chain taken to get to node, if any
+    bool same_player = false;     // ^ was of even length
+    uint64_t region_hash = 0; // Zobrist hash of the position's region key
+} SEARCH_FRAME;
+
+typedef struct SEARCH_CONTEXT {
+    const ZOBRIST_KEYS *zobrist = NULL;
+    TRANSPOSITION_TABLE *table = NULL;
+    uint64_t hash = 0; // Zobrist hash of the current position
+    uint64_t nodes = 0; // positions visited by the search so far
+    uint_fast16_t table_plies = 0;
+
+    const AUTOMORPHISM_GROUP *symmetry = NULL;
+    uint_fast16_t canon_plies = 0;
+    uint_fast16_t depth = 0; // number of moves made so far
+    std::vector<uint64_t> canon_words; // canonical keys, one row per ply
+    std::vector<uint16_t> visited_scratch;
+    uint64_t canonicalized = 0; // positions put into canonical form
+
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    std::vector<SEARCH_FRAME> frames; // stack for the iterative search
+
+    MOVE_ORDER move_order = MOVE_ORDER::LABEL;
+    uint_fast16_t order_plies = 0; // moves are put in order this many plies in
+    std::vector<uint32_t> move_stack; // ordered moves (CSR indices), by ply
+    std::vector<uint32_t> move_scores; // scratch for order_moves
+    std::vector<uint32_t> history;     // by CSR index, for MOVE_ORDER::HISTORY
+    std::vector<uint32_t> killers;     // by depth, for MOVE_ORDER::HISTORY
+    uint64_t cutoffs = 0;       // positions searched and found to be wins
+    uint64_t first_cutoffs = 0; // ^ where the first move tried was the winner
+
+    const GRAPH_BRIDGES *bridges = NULL; // only set if there are any
+    std::vector<TT_RESULT> bridge_results; // by CSR index, for bridge moves
+    uint64_t bridge_hits = 0; // moves across bridges answered from the above
+
+    const TABLEBASE *tablebase = NULL;
+    std::vector<uint32_t> residual_seen; // by node, == residual_stamp if seen
+    std::vector<uint8_t> residual_index; // by node, index in the residual graph
+    uint32_t residual_stamp = 0;
+    uint64_t tb_probes = 0; // residual graphs small enough to look up
+    uint64_t tb_hits = 0;
+
+    const SERIES_CHAINS *series = NULL; // only set if there are any
+    uint64_t chain_moves = 0; // chains taken (or ruled out) in one move
+
+    bool use_regions = false;
+    std::vector<uint64_t> region_adj;   // by node, packed neighbor sets
+    std::vector<uint64_t> region_words; // region keys, one row per ply
+    std::vector<uint64_t> region_scratch; // frontier, next frontier, reached
+    uint64_t region_cuts = 0; // region keys that dropped part of the graph
+
+    // by node, unused edges to a visited node, kept up to date move by move
+    // (see count_node_edges)
+    std::vector<uint16_t> cycle_edges;
+    uint64_t poisoned_moves = 0; // MAC moves ruled out as handing over a cycle
+} SEARCH_CONTEXT;
+
+// Scratch space for solve_tree_endgame, by node
+typedef struct TREE_SCRATCH {
+    std::vector<uint16_t> order;  // nodes in the order they were reached
+    std::vector<uint16_t> parent; // node each node was reached from
+    std::vector<uint32_t> seen;   // == stamp if reached by the current check
+    std::vector<bool> win;        // whether the player sitting there wins
+    uint32_t stamp = 0;
+} TREE_SCRATCH;
+
+/****************************************************************************
+ * init_search_context
+ *
+ * - Sets up a search context for a game starting at the given node
+ *
+ * Parameters :
+ * - context : the context to set up
+ * - zobrist : the graph's Zobrist keys, can be NULL if table is NULL
+ * - table : the transposition table to use, or NULL to not use one
+ * - symmetry : the graph's automorphisms to canonicalize early positions with,
+ * or NULL to not bother (ignored if table is NULL)
+ * - start_node : the node the game starts on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void init_search_context(SEARCH_CONTEXT *__restrict context,
+                         const ZOBRIST_KEYS *zobrist,
+                         TRANSPOSITION_TABLE *table,
+                         const AUTOMORPHISM_GROUP *symmetry,
+                         const uint_fast16_t start_node) {
+    *context = SEARCH_CONTEXT{};
+    context->table = table;
+    if (table != NULL) {
+        context->zobrist = zobrist;
+        context->hash = zobrist_start_key(*zobrist, start_node);
+        context->table_plies = std::max<uint_fast16_t>(
+            zobrist->visited_keys.size() / TT_DEPTH_FRACTION,
+            SYMMETRY_CANON_PLIES);
+        // no point in running through a group that's just the identity
+        if (symmetry != NULL && symmetry->size() > 1) {
+            context->symmetry = symmetry;
+            context->canon_plies = SYMMETRY_CANON_PLIES;
+            context->canon_words.resize(SYMMETRY_CANON_PLIES *
+                                        table->words_per_key);
+        }
+    }
+}
+
+/****************************************************************************
+ * restart_search_context
+ *
+ * - Gets an already set up search context ready for another game starting at
+ * the given node, keeping its table (and whatever's in it) and its counters
+ * - Table entries don't depend on the starting node (see
+ * Transposition_Table.h), so they're still good for the next game
+ *
+ * Parameters :
+ * - context : the context to restart
+ * - start_node : the node the next game starts on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void restart_search_context(SEARCH_CONTEXT *__restrict context,
+                            const uint_fast16_t start_node) {
+    context->depth = 0;
+    if (context->table != NULL) {
+        context->hash = zobrist_start_key(*context->zobrist, start_node);
+    }
+}
+
+/****************************************************************************
+ * set_move_order
+ *
+ * - Picks the order a context's games try moves in (see order_moves)
+ *
+ * Parameters :
+ * - context : the context
+ * - order : the move order
+ * - num_nodes : the number of nodes in the graph being played on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void set_move_order(SEARCH_CONTEXT *__restrict context, const MOVE_ORDER order,
+                    const uint_fast16_t num_nodes) {
+    context->move_order = order;
+    // ordering all the way down pays for itself: cutting it off partway only
+    // ever searched more positions, and never saved any time
+    context->order_plies = order == MOVE_ORDER::LABEL ? 0 : num_nodes;
+}
+
+/****************************************************************************
+ * set_bridges
+ *
+ * - Hands a context the graph's bridges (see Bridges.h), so its games can
+ * save what happens after each move across one
+ * - Once a move crosses a bridge, the rest of the game only depends on the
+ * move itself and not on how the game got there, so its result gets saved by
+ * the move's CSR index and never searched again. That goes for the rest of
+ * the context's games as well, whatever node they start from, so pendant
+ * pieces of the graph hanging off a bridge get solved once instead of once
+ * per path leading up to them
+ * - Does nothing if the graph doesn't have any bridges
+ *
+ * Parameters :
+ * - context : the context
+ * - graph : reference to the CSR form of the graph being played on
+ * - bridges : the graph's bridges, has to outlive the context's games
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void set_bridges(SEARCH_CONTEXT *__restrict context,
+                 const ADJACENCY_CSR &__restrict graph,
+                 const GRAPH_BRIDGES *bridges) {
+    if (bridges->num_bridges == 0) {
+        return;
+    }
+    context->bridges = bridges;
+    context->bridge_results.assign(graph.offsets[graph.num_nodes],
+                                   TT_RESULT::EMPTY);
+}
+
+/****************************************************************************
+ * set_series_chains
+ *
+ * - Hands a context the graph's chains of degree 2 nodes (see Series.h), so
+ * its games can take each one in a single move instead of a node at a time
+ * - Does nothing if the graph doesn't have any
+ *
+ * Parameters :
+ * - context : the context
+ * - series : the graph's chains, has to outlive the context's games
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void set_series_chains(SEARCH_CONTEXT *__restrict context,
+                       const SERIES_CHAINS *series) {
+    if (series->num_chains > 0) {
+        context->series = series;
+    }
+}
+
+/****************************************************************************
+ * set_region_keys
+ *
+ * - Has a context's games file positions in the table by their reachable
+ * region instead of by everything that's been visited (see region_key)
+ * - Does nothing if the context isn't using a table
+ *
+ * Parameters :
+ * - context : the context, already set up with its table
+ * - graph : reference to the CSR form of the graph being played on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void set_region_keys(SEARCH_CONTEXT *__restrict context,
+                     const ADJACENCY_CSR &__restrict graph) {
+    if (context->table == NULL) {
+        return;
+    }
+    const size_t words = context->table->words_per_key;
+    context->use_regions = true;
+    context->region_adj.assign(graph.num_nodes * words, 0);
+    for (uint_fast16_t node = 0; node < graph.num_nodes; node++) {
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            const uint16_t neighbor = graph.neighbors[adj_index];
+            context->region_adj[node * words + (neighbor >> 6)] |=
+                (uint64_t)1 << (neighbor & 63);
+        }
+    }
+    context->region_words.assign((context->table_plies + 1) * words, 0);
+    context->region_scratch.assign(3 * words, 0);
+}
+
+/****************************************************************************
+ * set_tablebase
+ *
+ * - Hands a context a loaded endgame tablebase (see Tablebase.h), so its games
+ * look up positions with small enough residual graphs instead of searching
+ * them
+ *
+ * Parameters :
+ * - context : the context
+ * - num_nodes : the number of nodes in the graph being played on
+ * - tablebase : the tablebase, has to outlive the context's games
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void set_tablebase(SEARCH_CONTEXT *__restrict context,
+                   const uint_fast16_t num_nodes, const TABLEBASE *tablebase) {
+    context->tablebase = tablebase;
+    context->residual_seen.assign(num_nodes, 0);
+    context->residual_index.assign(num_nodes, 0);
+    context->residual_stamp = 0;
+}
+
+/****************************************************************************
+ * note_winning_move
+ *
+ * - Lil helper function, credits a move with a win for MOVE_ORDER::HISTORY:
+ * bumps its history score (more for wins closer to the start of the game,
+ * which save more searching) and makes it the killer move at the current
+ * depth
+ *
+ * Parameters :
+ * - context : the search context, at the depth of the position that was won
+ * - adj_index : the winning move's CSR index
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+inline void note_winning_move(SEARCH_CONTEXT &__restrict context,
+                              const uint32_t adj_index) {
+    uint32_t &score = context.history[adj_index];
+    score += (uint32_t)(context.order_plies - context.depth);
+    if (score >= HISTORY_SCORE_LIMIT) [[unlikely]] { // age everything
+        for (uint32_t &entry : context.history) {
+            entry >>= 1;
+        }
+    }
+    context.killers[context.depth] = adj_index;
+}
+
+/****************************************************************************
+ * search_out_of_time
+ *
+ * - Lil helper function, checks whether a game has run past its deadline
+ * - Only actually looks at the clock every SEARCH_CLOCK_MASK + 1 positions
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ *
+ * Returns :
+ * - bool : true if the game should be abandoned
+ ****************************************************************************/
+inline bool search_out_of_time(const SEARCH_CONTEXT &__restrict context) {
+    return context.has_deadline &&
+           (context.nodes & SEARCH_CLOCK_MASK) == 0 &&
+           std::chrono::steady_clock::now() >= context.deadline;
+}
+
+/****************************************************************************
+ * count_node_edges
+ *
+ * - Counts up every node's unused edges to visited nodes, so the search can
+ * tell a MAC position is one move from closing a cycle, and how many replies
+ * a move leaves the opponent, without looking through any edges
+ * - From then on the counts are kept up to date by count_move/ uncount_move
+ * as moves get made and taken back
+ * - Every other node's unused edges don't need counting: nothing touching an
+ * unvisited node has been used yet (using an edge visits both of its ends), so
+ * an unvisited node's unused edges are all of its edges, and a node that's
+ * just been moved to has all of them but the one it was reached by
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - graph : reference to the CSR form of the graph being played on
+ * - edge_use_list : the current edge use list
+ * - node_use_list : the current node use list
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void count_node_edges(SEARCH_CONTEXT &__restrict context,
+                      const ADJACENCY_CSR &__restrict graph,
+                      const PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                      const PACKED_STATES<NODE_STATE> &__restrict node_use_list) {
+    context.cycle_edges.assign(graph.num_nodes, 0);
+    for (uint_fast16_t node = 0; node < graph.num_nodes; node++) {
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            if (edge_use_list.get(graph.edge_ids[adj_index]) ==
+                    EDGE_STATE::NOT_USED &&
+                node_use_list.get(graph.neighbors[adj_index]) ==
+                    NODE_STATE::USED) {
+                context.cycle_edges[node]++;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ * count_open_edges
+ *
+ * - Lil helper function, counts a node's unused edges the slow way, for the
+ * node a game starts on
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph being played on
+ * - edge_use_list : the current edge use list
+ * - node : the node in question
+ *
+ * Returns :
+ * - uint_fast16_t : the number of unused edges
+ ****************************************************************************/
+inline uint_fast16_t
+count_open_edges(const ADJACENCY_CSR &__restrict graph,
+                 const PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                 const uint_fast16_t node) {
+    uint_fast16_t open_edges = 0;
+    for (uint32_t adj_index = graph.offsets[node];
+         adj_index < graph.offsets[node + 1]; adj_index++) {
+        open_edges += edge_use_list.get(graph.edge_ids[adj_index]) ==
+                              EDGE_STATE::NOT_USED
+                          ? 1
+                          : 0;
+    }
+    return open_edges;
+}
+
+/****************************************************************************
+ * count_move
+ *
+ * - Lil helper function, updates the counts from count_node_edges for a move
+ * from from_node to the unvisited node to_node
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - graph : reference to the CSR form of the graph being played on
+ * - from_node : the node moved from
+ * - to_node : the node moved to
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+inline void count_move(SEARCH_CONTEXT &__restrict context,
+                       const ADJACENCY_CSR &__restrict graph,
+                       const uint_fast16_t from_node,
+                       const uint_fast16_t to_node) {
+    uint16_t *__restrict cycle_edges = context.cycle_edges.data();
+    for (uint32_t adj_index = graph.offsets[to_node];
+         adj_index < graph.offsets[to_node + 1]; adj_index++) {
+        cycle_edges[graph.neighbors[adj_index]]++;
+    }
+    // the edge moved along is used now, with both ends visited
+    cycle_edges[from_node]--;
+    cycle_edges[to_node]--;
+}
+
+/****************************************************************************
+ * uncount_move
+ *
+ * - Lil helper function, undoes count_move
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - graph : reference to the CSR form of the graph being played on
+ * - from_node : the node moved from
+ * - to_node : the node moved to
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+inline void uncount_move(SEARCH_CONTEXT &__restrict context,
+                         const ADJACENCY_CSR &__restrict graph,
+                         const uint_fast16_t from_node,
+                         const uint_fast16_t to_node) {
+    uint16_t *__restrict cycle_edges = context.cycle_edges.data();
+    cycle_edges[from_node]++;
+    cycle_edges[to_node]++;
+    for (uint32_t adj_index = graph.offsets[to_node];
+         adj_index < graph.offsets[to_node + 1]; adj_index++) {
+        cycle_edges[graph.neighbors[adj_index]]--;
+    }
+}
+
+/****************************************************************************
+ * poisoned_node
+ *
+ * - Lil helper function, checks whether moving onto an unvisited node is
+ * poison in MAC (see Tablebase.h): the node has an edge to a visited node, so
+ * whoever ends up there closes a cycle right away
+ * - The edge the node gets reached by doesn't count, it's used by then
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - graph : reference to the CSR form of the graph being played on
+ * - node_use_list : the current node use list
+ * - node : the unvisited node
+ * - from_node : the visited node it's reached from, or UINT16_MAX if it's
+ * reached from an unvisited one (the last node of a chain)
+ * - counted : true if the context's edge counts (see count_node_edges) are up
+ * to date for the position
+ *
+ * Returns :
+ * - bool : true if node is poison
+ ****************************************************************************/
+inline bool
+poisoned_node(const SEARCH_CONTEXT &__restrict context,
+              const ADJACENCY_CSR &__restrict graph,
+              const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+              const uint_fast16_t node, const uint_fast16_t from_node,
+              const bool counted) {
+    if (counted) {
+        return context.cycle_edges[node] > (from_node == UINT16_MAX ? 0 : 1);
+    }
+    for (uint32_t adj_index = graph.offsets[node];
+         adj_index < graph.offsets[node + 1]; adj_index++) {
+        const uint_fast16_t neighbor = graph.neighbors[adj_index];
+        if (neighbor != from_node &&
+            node_use_list.get(neighbor) == NODE_STATE::USED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/****************************************************************************
+ * search_key
+ *
+ * - Works out the key the current position is filed under in the
+ * transposition table: the position itself, or its canonical form if it's
+ * early enough in the game
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - curr_node : the current node
+ * - node_use_list : the current node use list
+ * - hash_out : where the key's hash is written
+ * - node_out : where the key's current node is written
+ *
+ * Returns :
+ * - const uint64_t * : the key's packed node use list, valid until the next
+ * call at the same depth
+ ****************************************************************************/
+inline const uint64_t *
+search_key(SEARCH_CONTEXT &__restrict context, const uint_fast16_t curr_node,
+           const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+           uint64_t *__restrict hash_out, uint32_t *__restrict node_out) {
+    if (context.depth >= context.canon_plies) [[likely]] {
+        *hash_out = context.hash;
+        *node_out = (uint32_t)curr_node;
+        return node_use_list.words.data();
+    }
+
+    uint64_t *canon_words =
+        &context.canon_words[context.depth * context.table->words_per_key];
+    *hash_out = canonical_position(*context.symmetry, *context.zobrist,
+                                   curr_node, node_use_list.words,
+                                   context.visited_scratch, node_out,
+                                   canon_words);
+    context.canonicalized++;
+    return canon_words;
+}
+
+/****************************************************************************
+ * region_key
+ *
+ * - Works out the key the current position is filed under in the
+ * transposition table when the context's using region keys: the current node,
+ * plus every node the game can't get to anymore rather than just every node
+ * that's been visited
+ * - From here on the game only ever moves onto unvisited nodes it can reach
+ * through other unvisited nodes (the region), in either game. Which of the
+ * nodes outside it were visited doesn't matter anymore: the ones next to the
+ * region were all visited (or they'd be in it), and the rest never come up
+ * again. So positions that only differ in parts of the graph that've been cut
+ * off share a table entry
+ * - The region's found by a breadth first search run a whole frontier at a
+ * time on packed node sets, and only ever looks inside the region a ply up,
+ * since regions only shrink. The key's hash is kept up to date the same way,
+ * by starting from the key a ply up and only adding in what got cut off
+ * - The same goes for MAC, as long as the position's already been checked for
+ * a move that closes a cycle (the only move onto a visited node)
+ *
+ * Parameters :
+ * - context : the search context of the current game
+ * - parent : the frame a ply up, or NULL if this is the first position
+ * - frame : the current position's frame
+ * - node_use_list : the current node use list
+ * - hash_out : where the key's hash is written
+ * - node_out : where the key's current node is written
+ *
+ * Returns :
+ * - const uint64_t * : the key's packed node list, valid until the next call
+ * at the same depth
+ ****************************************************************************/
+inline const uint64_t *
+region_key(SEARCH_CONTEXT &__restrict context, const SEARCH_FRAME *parent,
+           SEARCH_FRAME &__restrict frame,
+           const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+           uint64_t *__restrict hash_out, uint32_t *__restrict node_out) {
+    const size_t words = context.table->words_per_key;
+    const size_t num_nodes = node_use_list.size();
+    const uint64_t *visited = node_use_list.words.data();
+    const uint64_t *cut_off =
+        parent != NULL ? &context.region_words[(context.depth - 1) * words]
+                       : NULL;
+    uint64_t *key = &context.region_words[context.depth * words];
+    uint64_t *frontier = context.region_scratch.data();
+    uint64_t *next = frontier + words;
+    uint64_t *reached = next + words;
+    auto open = [&](const size_t word) { // unvisited and not cut off yet
+        const uint64_t in_graph = word + 1 < words || num_nodes % 64 == 0
+                                      ? UINT64_MAX
+                                      : ((uint64_t)1 << (num_nodes % 64)) - 1;
+        return ~(visited[word] | (cut_off != NULL ? cut_off[word] : 0)) &
+               in_graph;
+    };
+
+    bool any = false;
+    const uint64_t *curr_adj = &context.region_adj[frame.node * words];
+    for (size_t word = 0; word < words; word++) {
+        frontier[word] = curr_adj[word] & open(word);
+        reached[word] = 0;
+        any |= frontier[word] != 0;
+    }
+    while (any) {
+        for (size_t word = 0; word < words; word++) {
+            reached[word] |= frontier[word];
+            next[word] = 0;
+        }
+        for (size_t word = 0; word < words; word++) {
+            for (uint64_t bits = frontier[word]; bits != 0; bits &= bits - 1) {
+                const uint64_t *adj =
+                    &context.region_adj[(word * 64 + std::countr_zero(bits)) *
+                                        words];
+                for (size_t index = 0; index < words; index++) {
+                    next[index] |= adj[index];
+                }
+            }
+        }
+        any = false;
+        for (size_t word = 0; word < words; word++) {
+            frontier[word] = next[word] & open(word) & ~reached[word];
+            any |= frontier[word] != 0;
+        }
+    }
+
+    // everything that was open and didn't get reached just got cut off
+    uint64_t hash =
+        parent != NULL ? parent->region_hash ^ frame.move_key : context.hash;
+    bool cut = false;
+    for (size_t word = 0; word < words; word++) {
+        const uint64_t dropped = open(word) & ~reached[word];
+        for (uint64_t bits = dropped; bits != 0; bits &= bits - 1) {
+            hash ^= context.zobrist
+                        ->visited_keys[word * 64 + std::countr_zero(bits)];
+        }
+        cut |= dropped != 0;
+        key[word] = visited[word] | (cut_off != NULL ? cut_off[word] : 0) |
+                    dropped;
+    }
+    context.region_cuts += cut ? 1 : 0;
+    frame.region_hash = hash;
+
+    if (context.depth < context.canon_plies) {
+        // early on, symmetry's worth more than the region (and is cheaper to
+        // work out for a handful of visited nodes than for a whole region).
+        // Any position's plain key is also its region's key, so mixing the
+        // two in one table is fine
+        return search_key(context, frame.node, node_use_list, hash_out,
+                          node_out);
+    }
+    *hash_out = hash;
+    *node_out = (uint32_t)frame.node;
+    return key;
+}
+
+/****************************************************************************
+ * print_search_stats
+ *
+ * - Prints how many positions a quiet game searched, along with the
+ * transposition table's counters if one was used
+ *
+ * Parameters :
+ * - context : the search context of the finished game
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void print_search_stats(const SEARCH_CONTEXT &__restrict context) {
+    printf("\nPositions searched: %llu\n", (unsigned long long)context.nodes);
+    printf("Move order: %s, %llu wins found by searching, %.1f%% on the first "
+           "move tried\n",
+           MOVE_ORDER_NAMES[(size_t)context.move_order],
+           (unsigned long long)context.cutoffs,
+           context.cutoffs > 0 ? 100.0 * (double)context.first_cutoffs /
+                                     (double)context.cutoffs
+                               : 0.0);
+    if (context.bridges != NULL) {
+        printf("Bridges: %u (%u cut nodes), %llu moves across them looked "
+               "up instead of searched\n",
+               context.bridges->num_bridges, context.bridges->num_cut_nodes,
+               (unsigned long long)context.bridge_hits);
+    }
+    if (context.series != NULL) {
+        printf("Chains of degree 2 nodes: %u, %llu taken in one move\n",
+               context.series->num_chains,
+               (unsigned long long)context.chain_moves);
+    }
+    if (context.use_regions) {
+        printf("Region keys: %llu left out part of the graph\n",
+               (unsigned long long)context.region_cuts);
+    }
+    if (context.poisoned_moves > 0) {
+        printf("Poisoned moves: %llu handed over a cycle, and weren't "
+               "searched\n",
+               (unsigned long long)context.poisoned_moves);
+    }
+    if (context.tablebase != NULL) {
+        printf("Tablebase: %llu entries (up to %u edges), %llu positions small "
+               "enough to look up, %llu found\n",
+               (unsigned long long)context.tablebase->num_entries,
+               context.tablebase->max_edges,
+               (unsigned long long)context.tb_probes,
+               (unsigned long long)context.tb_hits);
+    }
+    if (context.table == NULL) {
+        printf("Transposition table: not used\n");
+        return;
+    }
+
+    const TT_STATS &stats = context.table->stats;
+    printf("Transposition table: %zu entries\n", context.table->entries.size());
+    printf("\tProbes: %llu, Hits: %llu (%.1f%%), Misses: %llu\n",
+           (unsigned long long)stats.probes, (unsigned long long)stats.hits,
+           stats.probes > 0 ? 100.0 * (double)stats.hits / (double)stats.probes
+                            : 0.0,
+           (unsigned long long)stats.misses);
+    printf("\tStores: %llu, Overwrites: %llu, Hash collisions: %llu\n",
+           (unsigned long long)stats.stores,
+           (unsigned long long)stats.overwrites,
+           (unsigned long long)stats.collisions);
+    if (context.symmetry != NULL) {
+        printf("Symmetry: %zu automorphisms%s, %llu positions canonicalized\n",
+               context.symmetry->size(),
+               context.symmetry->complete ? "" : " (incomplete)",
+               (unsigned long long)context.canonicalized);
+    }
+}
+
+/****************************************************************************
+ * to_tt_result/ from_tt_result
+ *
+ * - Lil helper functions to convert between GAME_STATE and the transposition
+ * table's result type
+ ****************************************************************************/
+inline TT_RESULT to_tt_result(const GAME_STATE state) {
+    return state == GAME_STATE::WIN_STATE ? TT_RESULT::WIN : TT_RESULT::LOSS;
+}
+
+inline GAME_STATE from_tt_result(const TT_RESULT result) {
+    return result == TT_RESULT::WIN ? GAME_STATE::WIN_STATE
+                                    : GAME_STATE::LOSS_STATE;
+}
 
 /****************************************************************************
  * fprint_indent
@@ -144,17 +954,220 @@ void fprint_move_hist(FILE *__restrict output, const uint_fast16_t recur_depth,
     }
 
     fprintf(
-        output, "%hu",
-        (uint16_t)
+        output, "%u",
+        (unsigned)
             move_hist[0]); // making the assumption there's at least one entry
     for (uint_fast16_t i = 1; i <= recur_depth; i++) {
-        fprintf(output, "->%hu",
-                (uint16_t)move_hist[i]); // added cast to provide consistent
+        fprintf(output, "->%u",
+                (unsigned)move_hist[i]); // added cast to provide consistent
                                          // operation, regardless of what the
                                          // compiler decided for uint_fast16_tss
     }
 }
 
+/****************************************************************************
+ * init_tree_scratch
+ *
+ * - Sizes a TREE_SCRATCH for a graph
+ *
+ * Parameters :
+ * - scratch : the scratch space to set up
+ * - num_nodes : the number of nodes in the graph
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void init_tree_scratch(TREE_SCRATCH *__restrict scratch,
+                       const uint_fast16_t num_nodes) {
+    scratch->order.resize(num_nodes);
+    scratch->parent.resize(num_nodes);
+    scratch->seen.assign(num_nodes, 0);
+    scratch->win.assign(num_nodes, false);
+    scratch->stamp = 0;
+}
+
+/****************************************************************************
+ * solve_tree_endgame
+ *
+ * - Tries to solve a position without searching it, which works once the
+ * unvisited nodes the game can still reach from the current node form a tree
+ * hanging off of it (no edges between them other than the tree's own). From
+ * there on every move just goes down the tree, and the only cycles left to
+ * close are through edges back to visited nodes
+ * - That's a simple game on a rooted tree: a node is a win for the player
+ * sitting on it if moving to some child leaves the other player on a loss. In
+ * MAC, a player sitting on a node with an edge back to a visited node wins on
+ * the spot. In AAC those edges are never worth taking, so they're left out
+ * - Reaching the tree is a breadth first search that bails out as soon as it
+ * finds a second way to some node, and solving it is one pass back over the
+ * search's order, so it's all linear in the size of the tree
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph in question
+ * - node_use_list : the position's node use list
+ * - scratch : scratch space, set up with init_tree_scratch
+ * - curr_node : the position's current node. In MAC, it must not have any
+ * unused edges back to visited nodes (the position would be an immediate win)
+ * - result_out : set to the position's result, if it was solved
+ *
+ * Returns :
+ * - bool : true if the position was solved (positions without any moves
+ * aren't)
+ ****************************************************************************/
+template <bool MAC>
+bool solve_tree_endgame(
+    const ADJACENCY_CSR &__restrict graph,
+    const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+    TREE_SCRATCH &__restrict scratch, const uint_fast16_t curr_node,
+    GAME_STATE *__restrict result_out) {
+    if (++scratch.stamp == 0) [[unlikely]] { // wrapped around
+        std::fill(scratch.seen.begin(), scratch.seen.end(), 0);
+        scratch.stamp = 1;
+    }
+    const uint32_t stamp = scratch.stamp;
+    uint32_t num_reached = 0;
+
+    // unvisited nodes haven't had any of their edges used yet, so every edge
+    // out of one is open
+    scratch.seen[curr_node] = stamp;
+    scratch.order[num_reached++] = (uint16_t)curr_node;
+    for (uint32_t head = 0; head < num_reached; head++) {
+        const uint_fast16_t node = scratch.order[head];
+        bool back_edge = false; // an edge back to a visited node
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            const uint_fast16_t neighbor = graph.neighbors[adj_index];
+            if (head > 0 && neighbor == scratch.parent[node]) {
+                continue;
+            }
+            if (node_use_list.get(neighbor) == NODE_STATE::USED) {
+                back_edge = true;
+            } else if (scratch.seen[neighbor] == stamp) {
+                return false; // reached twice, so there's a cycle
+            } else {
+                scratch.seen[neighbor] = stamp;
+                scratch.parent[neighbor] = (uint16_t)node;
+                scratch.order[num_reached++] = (uint16_t)neighbor;
+            }
+        }
+        // (the current node's edges back are either used or not its problem)
+        scratch.win[node] = MAC && back_edge && head > 0;
+    }
+
+    if (num_reached == 1) { // no moves at all, nothing to solve
+        return false;
+    }
+
+    // children before parents, each node tells its parent whether moving to
+    // it wins
+    for (uint32_t index = num_reached - 1; index > 0; index--) {
+        const uint_fast16_t node = scratch.order[index];
+        if (!scratch.win[node]) {
+            scratch.win[scratch.parent[node]] = true;
+        }
+    }
+    *result_out = scratch.win[curr_node] ? GAME_STATE::WIN_STATE
+                                         : GAME_STATE::LOSS_STATE;
+    return true;
+}
+
+/****************************************************************************
+ * residual_graph
+ *
+ * - Collects the part of the graph the rest of the game can still be played
+ * on (see Tablebase.h): the current node plus the unvisited nodes reachable
+ * from it, leaving out (MAC) nodes with an unused edge back to a visited node
+ * other than the current one, or with a self loop (whoever lands there can
+ * close it)
+ * - Self loops never make it into the residual graph, since the tablebase has
+ * no way to store them. An AAC game can't ever move along one, and in MAC the
+ * current node's loop has to be used already (or the game would be won)
+ * - Gives up as soon as it's clear the residual graph won't fit in the
+ * tablebase, so big residual graphs only cost a few steps
+ * - MAC positions have to have already passed the "is there an unused edge
+ * back to a visited node?" check
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph in question
+ * - node_use_list : the current node use list
+ * - context : the search context, for its scratch space
+ * - curr_node : the current node
+ * - max_edges : the most edges the residual graph can have
+ * - residual_out : where the residual graph is written, with curr_node as
+ * node 0
+ *
+ * Returns :
+ * - bool : false if the residual graph is too big
+ ****************************************************************************/
+template <bool MAC>
+bool residual_graph(const ADJACENCY_CSR &__restrict graph,
+                    const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                    SEARCH_CONTEXT &__restrict context,
+                    const uint_fast16_t curr_node, const uint32_t max_edges,
+                    SMALL_GRAPH *__restrict residual_out) {
+    if (++context.residual_stamp == 0) [[unlikely]] { // wrapped around
+        std::fill(context.residual_seen.begin(), context.residual_seen.end(),
+                  0);
+        context.residual_stamp = 1;
+    }
+    const uint32_t stamp = context.residual_stamp;
+    uint16_t members[TB_MAX_NODES]; // doubles as the BFS queue
+    uint_fast8_t num_members = 1;
+    uint32_t num_edges = 0;
+    members[0] = (uint16_t)curr_node;
+    context.residual_seen[curr_node] = stamp;
+    context.residual_index[curr_node] = 0;
+    *residual_out = SMALL_GRAPH{};
+
+    for (uint_fast8_t index = 0; index < num_members; index++) {
+        const uint_fast16_t node = members[index];
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            const uint_fast16_t neighbor = graph.neighbors[adj_index];
+            if (neighbor == node ||
+                node_use_list.get(neighbor) == NODE_STATE::USED) {
+                continue;
+            }
+            if (context.residual_seen[neighbor] != stamp) {
+                context.residual_seen[neighbor] = stamp;
+                bool poisoned = false;
+                for (uint32_t reply = graph.offsets[neighbor];
+                     MAC && reply < graph.offsets[neighbor + 1] && !poisoned;
+                     reply++) {
+                    const uint_fast16_t reply_node = graph.neighbors[reply];
+                    poisoned = reply_node == neighbor ||
+                               (reply_node != curr_node &&
+                                node_use_list.get(reply_node) ==
+                                    NODE_STATE::USED);
+                }
+                if (poisoned) {
+                    context.residual_index[neighbor] = UINT8_MAX;
+                    continue;
+                }
+                if (num_members == TB_MAX_NODES) {
+                    return false;
+                }
+                context.residual_index[neighbor] = (uint8_t)num_members;
+                members[num_members++] = (uint16_t)neighbor;
+            }
+            // every edge gets seen from both ends, only count it from the end
+            // that joined first
+            const uint_fast8_t other = context.residual_index[neighbor];
+            if (other == UINT8_MAX || other < index) {
+                continue;
+            }
+            if (++num_edges > max_edges) {
+                return false;
+            }
+            residual_out->adj[index] |= (uint16_t)(1U << other);
+            residual_out->adj[other] |= (uint16_t)(1U << index);
+        }
+    }
+    residual_out->num_nodes = num_members;
+
+    return true;
+}
+
 /****************************************************************************
  * play_MAC_quiet
  *
@@ -163,40 +1176,43 @@ void fprint_move_hist(FILE *__restrict output, const uint_fast16_t recur_depth,
  *
  * Parameters :
  * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
+ * given in the graph's adjacency listing
+ * - graph : reference to the CSR form of the graph in question
+ * - edge_use_list : reference to a packed list keeping track of which edges
+ * have been used so far in the game, indexed by edge ID
+ * - node_use_list : reference to a packed list keeping track of which nodes
  * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
+ * - context : the search context (transposition table, position hash, and
+ * counters) for the current game
  *
  * Returns :
- * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
+ * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE,
+ * or KILL_STATE if the game ran past its deadline
  ****************************************************************************/
 GAME_STATE
-play_MAC_quiet(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-               const std::vector<Adjacency_Info> &__restrict adj_matrix,
-               std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-               std::vector<NODE_STATE> &__restrict node_use_list) {
+play_MAC_quiet(const uint_fast16_t curr_node,
+               const ADJACENCY_CSR &__restrict graph,
+               PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+               PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+               SEARCH_CONTEXT &__restrict context) {
+    context.nodes++;
+    if (search_out_of_time(context)) [[unlikely]] {
+        return GAME_STATE::KILL_STATE;
+    }
     uint_fast16_t open_edges = 0; // stores the number of available edges we can
                                   // move along from curr_node
     GAME_STATE
         move_result; // temporarily store the result of a recursive call here
 
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+            EDGE_STATE::NOT_USED) { // if the edge between curr_node and
+                                    // curr_neighbor is unused
             open_edges++;
-            if (node_use_list[curr_neighbor] ==
+            if (node_use_list.get(curr_neighbor) ==
                 NODE_STATE::USED) { // if the neighbor has been previously
                                     // visited, going back creates a cycle!
                 return GAME_STATE::WIN_STATE;
@@ -208,38 +1224,66 @@ play_MAC_quiet(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
         return GAME_STATE::LOSS_STATE;
     }
 
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
+    // the cheap checks above didn't settle things, so see if we've already
+    // solved this position before searching any further
+    uint64_t key_hash = 0;
+    uint32_t key_node = 0;
+    const uint64_t *key_words = NULL;
+    if (context.table != NULL && context.depth < context.table_plies) {
+        key_words =
+            search_key(context, curr_node, node_use_list, &key_hash, &key_node);
+        const TT_RESULT stored =
+            tt_probe(context.table, key_hash, key_node, key_words);
+        if (stored != TT_RESULT::EMPTY) {
+            return from_tt_result(stored);
+        }
+    }
+    const uint64_t start_nodes = context.nodes;
+    GAME_STATE result = GAME_STATE::LOSS_STATE; // until a good move turns up
+
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+            EDGE_STATE::NOT_USED) { // if the edge between curr_node and
+                                    // curr_neighbor is unused
+            const uint64_t move_key =
+                context.table != NULL
+                    ? zobrist_move_key(*context.zobrist, curr_node,
+                                       curr_neighbor)
+                    : 0;
             // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result = play_MAC_quiet(curr_neighbor, num_nodes, adj_matrix,
-                                         edge_use_matrix, node_use_list);
+            edge_use_list.set(curr_edge, EDGE_STATE::USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::USED);
+            context.hash ^= move_key;
+            context.depth++;
+            move_result = play_MAC_quiet(curr_neighbor, graph, edge_use_list,
+                                         node_use_list, context);
             // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
+            edge_use_list.set(curr_edge, EDGE_STATE::NOT_USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::NOT_USED);
+            context.hash ^= move_key;
+            context.depth--;
             if (move_result ==
                 GAME_STATE::LOSS_STATE) { // if the move puts the game into a
                                           // loss state, then the current state
                                           // is a win state
-                return GAME_STATE::WIN_STATE;
+                result = GAME_STATE::WIN_STATE;
+                break;
+            } else if (move_result == GAME_STATE::KILL_STATE) {
+                return GAME_STATE::KILL_STATE;
             }
         }
     }
 
-    // if we've gotten to this point there's no good moves-> game is in a loss
+    // if we didn't find a good move there's no good moves-> game is in a loss
     // state
-    return GAME_STATE::LOSS_STATE;
+    if (context.table != NULL && context.depth < context.table_plies) {
+        tt_store(context.table, key_hash, key_node, key_words,
+                 to_tt_result(result), context.nodes - start_nodes + 1);
+    }
+    return result;
 }
 
 /****************************************************************************
@@ -249,68 +1293,74 @@ play_MAC_quiet(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
  * find a winning move from each player's "perspective" in turn
  * - The "loud" version prints its progress in playing through the game to a
  * file as it goes
+ * - Once the unvisited nodes still in reach form a tree, the rest of the game
+ * is solved in one go (see solve_tree_endgame) rather than logged move by move
  *
  * Parameters :
  * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
+ * given in the graph's adjacency listing
+ * - graph : reference to the CSR form of the graph in question
+ * - edge_use_list : reference to a packed list keeping track of which edges
+ * have been used so far in the game, indexed by edge ID
+ * - node_use_list : reference to a packed list keeping track of which nodes
  * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
  * - move_hist : reference to a vector keeping track of the current chain's
  * move history
  * - recur_depth : the recursive depth of the current call
  * - output : the file to output our progress to
+ * - tree_scratch : scratch space for solve_tree_endgame, shared by every
+ * position in the game. Leave it out at the top of the game and one gets set
+ * up there
  *
  * Returns :
  * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
  ****************************************************************************/
 GAME_STATE
-play_MAC_loud(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-              const std::vector<Adjacency_Info> &__restrict adj_matrix,
-              std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-              std::vector<NODE_STATE> &__restrict node_use_list,
+play_MAC_loud(const uint_fast16_t curr_node,
+              const ADJACENCY_CSR &__restrict graph,
+              PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+              PACKED_STATES<NODE_STATE> &__restrict node_use_list,
               std::vector<uint_fast16_t> &__restrict move_hist,
-              const uint_fast16_t recur_depth, FILE *__restrict output) {
+              const uint_fast16_t recur_depth, FILE *__restrict output,
+              TREE_SCRATCH *tree_scratch = NULL) {
     uint_fast16_t open_edges = 0; // stores the number of available edges we can
                                   // move along from curr_node
     GAME_STATE
         move_result; // temporarily store the result of a recursive call here
     move_hist[recur_depth] =
         curr_node; // record the current position in the move history
+    TREE_SCRATCH own_scratch;
+    if (tree_scratch == NULL) { // top of the game
+        init_tree_scratch(&own_scratch, graph.num_nodes);
+        tree_scratch = &own_scratch;
+    }
 
-    progress_log(output, recur_depth, "%s Reached node %hu\n",
-                 recur_depth % 2 == 0 ? "P1:" : "P2:", (uint16_t)curr_node);
+    progress_log(output, recur_depth, "%s Reached node %u\n",
+                 recur_depth % 2 == 0 ? "P1:" : "P2:", (unsigned)curr_node);
 
     progress_log(output, recur_depth,
                  "Checking for any cycles that are one move away.\n");
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+            EDGE_STATE::NOT_USED) { // if the edge between curr_node and
+                                    // curr_neighbor is unused
             progress_log(output, recur_depth,
-                         "%s Checking the play from node %hu to %hu\n",
+                         "%s Checking the play from node %u to %u\n",
                          recur_depth % 2 == 0 ? "P1:" : "P2:",
-                         (uint16_t)curr_node, (uint16_t)curr_neighbor);
+                         (unsigned)curr_node, (unsigned)curr_neighbor);
             open_edges++;
-            if (node_use_list[curr_neighbor] ==
+            if (node_use_list.get(curr_neighbor) ==
                 NODE_STATE::USED) { // if the neighbor has been previously
                                     // visited, going back creates a cycle!
                 progress_log(output, recur_depth,
                              "Cycle detected. Move history: ");
                 fprint_move_hist(output, recur_depth, move_hist);
                 fprintf(
-                    output, "->%hu\n",
-                    (uint16_t)curr_neighbor); // since we don't formally "move"
+                    output, "->%u\n",
+                    (unsigned)curr_neighbor); // since we don't formally "move"
                                               // to this node, it's not included
                                               // in the move_hist array
                 return GAME_STATE::WIN_STATE;
@@ -328,40 +1378,47 @@ play_MAC_loud(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
         return GAME_STATE::LOSS_STATE;
     }
 
+    GAME_STATE tree_result;
+    if (solve_tree_endgame<true>(graph, node_use_list, *tree_scratch,
+                                 curr_node, &tree_result)) {
+        progress_log(output, recur_depth,
+                     "%s The unvisited nodes left in reach form a tree, the "
+                     "game is in a %s.\n",
+                     recur_depth % 2 == 0 ? "P1:" : "P2:",
+                     tree_result == GAME_STATE::WIN_STATE ? "WIN_STATE"
+                                                          : "LOSS_STATE");
+        return tree_result;
+    }
+
     progress_log(output, recur_depth, "Checking all available moves now.\n");
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+            EDGE_STATE::NOT_USED) { // if the edge between curr_node and
+                                    // curr_neighbor is unused
             // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result = play_MAC_loud(curr_neighbor, num_nodes, adj_matrix,
-                                        edge_use_matrix, node_use_list,
-                                        move_hist, recur_depth + 1, output);
+            edge_use_list.set(curr_edge, EDGE_STATE::USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::USED);
+            move_result = play_MAC_loud(curr_neighbor, graph, edge_use_list,
+                                        node_use_list, move_hist,
+                                        recur_depth + 1, output, tree_scratch);
             // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
+            edge_use_list.set(curr_edge, EDGE_STATE::NOT_USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::NOT_USED);
             progress_log(output, recur_depth,
-                         "%s Playing from %hu to %hu results in a %s.",
+                         "%s Playing from %u to %u results in a %s.",
                          recur_depth % 2 == 0 ? "P1:" : "P2:",
-                         (uint16_t)curr_node, (uint16_t)curr_neighbor,
+                         (unsigned)curr_node, (unsigned)curr_neighbor,
                          move_result == GAME_STATE::WIN_STATE ? "LOSS_STATE"
                                                               : "WIN_STATE");
             progress_log(output, 0,
                          "Move history: "); // haven't gone to a new line yet so
                                             // we set recursion depth to 0
             fprint_move_hist(output, recur_depth, move_hist);
-            fprintf(output, "->%hu\n",
-                    (uint16_t)curr_neighbor); // since we don't formally "move"
+            fprintf(output, "->%u\n",
+                    (unsigned)curr_neighbor); // since we don't formally "move"
                                               // to this node, it's not included
                                               // in the move_hist array
             if (move_result ==
@@ -389,60 +1446,94 @@ play_MAC_loud(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
  *
  * Parameters :
  * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
+ * given in the graph's adjacency listing
+ * - graph : reference to the CSR form of the graph in question
+ * - edge_use_list : reference to a packed list keeping track of which edges
+ * have been used so far in the game, indexed by edge ID
+ * - node_use_list : reference to a packed list keeping track of which nodes
  * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
+ * - context : the search context (transposition table, position hash, and
+ * counters) for the current game
  *
  * Returns :
- * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
+ * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE,
+ * or KILL_STATE if the game ran past its deadline
  ****************************************************************************/
 GAME_STATE
-play_AAC_quiet(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-               const std::vector<Adjacency_Info> &__restrict adj_matrix,
-               std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-               std::vector<NODE_STATE> &__restrict node_use_list) {
+play_AAC_quiet(const uint_fast16_t curr_node,
+               const ADJACENCY_CSR &__restrict graph,
+               PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+               PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+               SEARCH_CONTEXT &__restrict context) {
+    context.nodes++;
+    if (search_out_of_time(context)) [[unlikely]] {
+        return GAME_STATE::KILL_STATE;
+    }
     GAME_STATE
         move_result; // temporarily store the result of a recursive call here
 
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            && edge_use_matrix[index_translation(num_nodes, curr_node,
-                                                 curr_neighbor)] ==
-                   EDGE_STATE::NOT_USED // and the edge between them is unused
-            && node_use_list[curr_neighbor] ==
+    // see if we've already solved this position before searching it
+    uint64_t key_hash = 0;
+    uint32_t key_node = 0;
+    const uint64_t *key_words = NULL;
+    if (context.table != NULL && context.depth < context.table_plies) {
+        key_words =
+            search_key(context, curr_node, node_use_list, &key_hash, &key_node);
+        const TT_RESULT stored =
+            tt_probe(context.table, key_hash, key_node, key_words);
+        if (stored != TT_RESULT::EMPTY) {
+            return from_tt_result(stored);
+        }
+    }
+    const uint64_t start_nodes = context.nodes;
+    GAME_STATE result = GAME_STATE::LOSS_STATE; // until a good move turns up
+
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+                EDGE_STATE::NOT_USED // if the edge between curr_node and
+                                     // curr_neighbor is unused
+            && node_use_list.get(curr_neighbor) ==
                    NODE_STATE::NOT_USED) { // move doesn't immediately result in
                                            // a cycle, might as well try it out
+            const uint64_t move_key =
+                context.table != NULL
+                    ? zobrist_move_key(*context.zobrist, curr_node,
+                                       curr_neighbor)
+                    : 0;
             // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result = play_AAC_quiet(curr_neighbor, num_nodes, adj_matrix,
-                                         edge_use_matrix, node_use_list);
+            edge_use_list.set(curr_edge, EDGE_STATE::USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::USED);
+            context.hash ^= move_key;
+            context.depth++;
+            move_result = play_AAC_quiet(curr_neighbor, graph, edge_use_list,
+                                         node_use_list, context);
             // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
+            edge_use_list.set(curr_edge, EDGE_STATE::NOT_USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::NOT_USED);
+            context.hash ^= move_key;
+            context.depth--;
             if (move_result ==
                 GAME_STATE::LOSS_STATE) { // if the move puts the game into a
                                           // loss state, then the current state
                                           // is a win state
-                return GAME_STATE::WIN_STATE;
+                result = GAME_STATE::WIN_STATE;
+                break;
+            } else if (move_result == GAME_STATE::KILL_STATE) {
+                return GAME_STATE::KILL_STATE;
             }
         }
     }
 
-    // if we've gotten to this point there's no good moves-> game is in a loss
+    // if we didn't find a good move there's no good moves-> game is in a loss
     // state
-    return GAME_STATE::LOSS_STATE;
+    if (context.table != NULL && context.depth < context.table_plies) {
+        tt_store(context.table, key_hash, key_node, key_words,
+                 to_tt_result(result), context.nodes - start_nodes + 1);
+    }
+    return result;
 }
 
 /****************************************************************************
@@ -450,73 +1541,94 @@ play_AAC_quiet(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
  *
  * - Plays the AAC game on the specified graph by recursively attempting to
  * find a winning move from each player's "perspective" in turn
+ * - Once the unvisited nodes still in reach form a tree, the rest of the game
+ * is solved in one go (see solve_tree_endgame) rather than logged move by move
  *
  * Parameters :
  * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
+ * given in the graph's adjacency listing
+ * - graph : reference to the CSR form of the graph in question
+ * - edge_use_list : reference to a packed list keeping track of which edges
+ * have been used so far in the game, indexed by edge ID
+ * - node_use_list : reference to a packed list keeping track of which nodes
  * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
+ * - move_hist : reference to a vector keeping track of the current chain's
+ * move history
+ * - recur_depth : the recursive depth of the current call
+ * - output : the file to output our progress to
+ * - tree_scratch : scratch space for solve_tree_endgame, shared by every
+ * position in the game. Leave it out at the top of the game and one gets set
+ * up there
  *
  * Returns :
  * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
  ****************************************************************************/
 GAME_STATE
-play_AAC_loud(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-              const std::vector<Adjacency_Info> &__restrict adj_matrix,
-              std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-              std::vector<NODE_STATE> &__restrict node_use_list,
+play_AAC_loud(const uint_fast16_t curr_node,
+              const ADJACENCY_CSR &__restrict graph,
+              PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+              PACKED_STATES<NODE_STATE> &__restrict node_use_list,
               std::vector<uint_fast16_t> &__restrict move_hist,
-              const uint_fast16_t recur_depth, FILE *__restrict output) {
+              const uint_fast16_t recur_depth, FILE *__restrict output,
+              TREE_SCRATCH *tree_scratch = NULL) {
     GAME_STATE
         move_result; // temporarily store the result of a recursive call here
     move_hist[recur_depth] =
         curr_node; // record the current position in the move history
+    TREE_SCRATCH own_scratch;
+    if (tree_scratch == NULL) { // top of the game
+        init_tree_scratch(&own_scratch, graph.num_nodes);
+        tree_scratch = &own_scratch;
+    }
+
+    progress_log(output, recur_depth, "%s Reached node %u\n",
+                 recur_depth % 2 == 0 ? "P1:" : "P2:", (unsigned)curr_node);
 
-    progress_log(output, recur_depth, "%s Reached node %hu\n",
-                 recur_depth % 2 == 0 ? "P1:" : "P2:", (uint16_t)curr_node);
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            && edge_use_matrix[index_translation(num_nodes, curr_node,
-                                                 curr_neighbor)] ==
-                   EDGE_STATE::NOT_USED // and the edge between them is unused
-            && node_use_list[curr_neighbor] ==
+    GAME_STATE tree_result;
+    if (solve_tree_endgame<false>(graph, node_use_list, *tree_scratch,
+                                  curr_node, &tree_result)) {
+        progress_log(output, recur_depth,
+                     "%s The unvisited nodes left in reach form a tree, the "
+                     "game is in a %s.\n",
+                     recur_depth % 2 == 0 ? "P1:" : "P2:",
+                     tree_result == GAME_STATE::WIN_STATE ? "WIN_STATE"
+                                                          : "LOSS_STATE");
+        return tree_result;
+    }
+
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(curr_edge) ==
+                EDGE_STATE::NOT_USED // if the edge between curr_node and
+                                     // curr_neighbor is unused
+            && node_use_list.get(curr_neighbor) ==
                    NODE_STATE::NOT_USED) { // move doesn't immediately result in
                                            // a cycle, might as well try it out
             progress_log(output, recur_depth,
-                         "%s Checking the play from node %hu to %hu\n",
+                         "%s Checking the play from node %u to %u\n",
                          recur_depth % 2 == 0 ? "P1:" : "P2:",
-                         (uint16_t)curr_node, (uint16_t)curr_neighbor);
+                         (unsigned)curr_node, (unsigned)curr_neighbor);
             // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result = play_AAC_loud(curr_neighbor, num_nodes, adj_matrix,
-                                        edge_use_matrix, node_use_list,
-                                        move_hist, recur_depth + 1, output);
+            edge_use_list.set(curr_edge, EDGE_STATE::USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::USED);
+            move_result = play_AAC_loud(curr_neighbor, graph, edge_use_list,
+                                        node_use_list, move_hist,
+                                        recur_depth + 1, output, tree_scratch);
             // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
+            edge_use_list.set(curr_edge, EDGE_STATE::NOT_USED);
+            node_use_list.set(curr_neighbor, NODE_STATE::NOT_USED);
             progress_log(output, recur_depth,
-                         "%s Playing from %hu to %hu results in a %s. ",
+                         "%s Playing from %u to %u results in a %s. ",
                          recur_depth % 2 == 0 ? "P1:" : "P2:",
-                         (uint16_t)curr_node, (uint16_t)curr_neighbor,
+                         (unsigned)curr_node, (unsigned)curr_neighbor,
                          move_result == GAME_STATE::WIN_STATE ? "LOSS_STATE"
                                                               : "WIN_STATE");
             progress_log(output, 0, "Move history: ");
             fprint_move_hist(output, recur_depth, move_hist);
-            fprintf(output, "->%hu\n",
-                    (uint16_t)curr_neighbor); // since we don't formally "move"
+            fprintf(output, "->%u\n",
+                    (unsigned)curr_neighbor); // since we don't formally "move"
                                               // to this node, it's not included
                                               // in the move_hist array
             if (move_result ==
@@ -535,3 +1647,616 @@ play_AAC_loud(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
                  recur_depth % 2 == 0 ? "P1:" : "P2:", curr_node);
     return GAME_STATE::LOSS_STATE;
 }
+
+/****************************************************************************
+ * order_moves
+ *
+ * - Lists the moves available from a position, best first according to the
+ * context's move order (ties are left in label order)
+ * - A "reply" below is a move the opponent could make right after ours
+ * - Replies are counted from the context's edge counts (see count_node_edges),
+ * which have to be up to date for the position
+ *
+ * Parameters :
+ * - graph : the graph
+ * - edge_use_list : the position's edge use list
+ * - node_use_list : the position's node use list
+ * - context : the search context, for its move order and tables
+ * - curr_node : the position's current node
+ * - moves_out : where the moves (CSR indices) are written, needs room for
+ * curr_node's degree
+ *
+ * Returns :
+ * - uint32_t : the number of moves written
+ ****************************************************************************/
+template <bool MAC>
+uint32_t order_moves(const ADJACENCY_CSR &__restrict graph,
+                     const PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                     const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                     SEARCH_CONTEXT &__restrict context,
+                     const uint_fast16_t curr_node,
+                     uint32_t *__restrict moves_out) {
+    uint32_t *scores = context.move_scores.data();
+    const uint32_t killer = context.killers[context.depth];
+    uint32_t num_moves = 0;
+
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint_fast16_t neighbor = graph.neighbors[adj_index];
+        const uint32_t edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(edge) != EDGE_STATE::NOT_USED ||
+            (!MAC && node_use_list.get(neighbor) != NODE_STATE::NOT_USED)) {
+            continue;
+        }
+
+        uint32_t score = 0; // lower goes first
+        if (context.move_order == MOVE_ORDER::HISTORY) {
+            score = adj_index == killer
+                        ? 0
+                        : UINT32_MAX - context.history[adj_index];
+        } else {
+            // the opponent's replies, and (MAC) whether any of them closes a
+            // cycle, straight from the edge counts (see count_node_edges).
+            // neighbor's unvisited, so all its edges are unused, and the one
+            // we'd come in on counts as one to a visited node (curr_node)
+            // until the move's made
+            const uint32_t replies =
+                graph.offsets[neighbor + 1] - graph.offsets[neighbor] -
+                context.cycle_edges[neighbor];
+            const bool cycle_reply =
+                MAC && context.cycle_edges[neighbor] > 1;
+            if (context.move_order == MOVE_ORDER::SAFE_FIRST) {
+                score = MAC ? (cycle_reply ? 1 : 0) : (replies == 0 ? 0 : 1);
+            } else { // MOBILITY
+                score = cycle_reply ? UINT32_MAX : replies;
+            }
+        }
+
+        // insertion sort, keeping equal scores in label order
+        uint32_t slot = num_moves++;
+        while (slot > 0 && scores[slot - 1] > score) {
+            scores[slot] = scores[slot - 1];
+            moves_out[slot] = moves_out[slot - 1];
+            slot--;
+        }
+        scores[slot] = score;
+        moves_out[slot] = adj_index;
+    }
+
+    return num_moves;
+}
+
+/****************************************************************************
+ * play_quiet_iterative
+ *
+ * - Plays the MAC or AAC game exactly like play_MAC_quiet/ play_AAC_quiet
+ * (same move order, same table use, same result and position count), but
+ * with an explicit stack of SEARCH_FRAMEs instead of recursion, so a long
+ * game can't run the thread out of stack
+ * - The frames live in the context and are allocated once, one per node in
+ * the graph (every move visits a new node, so no game goes deeper than that)
+ * - If the game's abandoned (KILL_STATE), every move made is taken back before
+ * returning, so the use lists are left the way they were passed in
+ * - In the first context.order_plies moves, a position's moves are tried in
+ * the context's move order (see order_moves) rather than label order. That
+ * can change how much gets searched, but not the result
+ * - Moves across a bridge whose result is already known (see set_bridges) are
+ * taken care of without going a ply deeper, which again only changes how
+ * much gets searched
+ * - Chains of degree 2 nodes (see set_series_chains) are taken in one move,
+ * and count as a single ply. A chain that runs into a visited node is never
+ * gone down at all, its parity alone says how it turns out
+ * - Positions with ordered moves keep the edge counts from count_node_edges
+ * up to date as moves are made and taken back, so neither ordering their
+ * moves nor (MAC) checking for a cycle to close looks through any edges
+ * - In MAC, a move (or chain) onto a poisoned node (see poisoned_node) hands
+ * whoever ends up there a cycle to close, so it's never gone down either
+ *
+ * Parameters :
+ * - curr node : the node the game starts from
+ * - graph : reference to the CSR form of the graph in question
+ * - edge_use_list : reference to a packed list keeping track of which edges
+ * have been used so far in the game, indexed by edge ID
+ * - node_use_list : reference to a packed list keeping track of which nodes
+ * have been used so far in the game
+ * - context : the search context (transposition table, position hash, and
+ * counters) for the current game
+ *
+ * Returns :
+ * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE,
+ * or KILL_STATE if the game ran past its deadline
+ ****************************************************************************/
+template <bool MAC>
+GAME_STATE
+play_quiet_iterative(const uint_fast16_t curr_node,
+                     const ADJACENCY_CSR &__restrict graph,
+                     PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                     PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                     SEARCH_CONTEXT &__restrict context) {
+    if (context.frames.size() < (size_t)graph.num_nodes + 1) {
+        context.frames.resize((size_t)graph.num_nodes + 1);
+    }
+    const bool use_order = context.move_order != MOVE_ORDER::LABEL &&
+                           context.order_plies > 0;
+    const size_t num_adj = graph.offsets[graph.num_nodes];
+    if (use_order && context.move_stack.size() < num_adj) {
+        // a game's moves never use a node's row twice, so the rows' total
+        // length is enough for the ordered moves of a whole line of play
+        context.move_stack.resize(num_adj);
+        context.move_scores.resize(num_adj);
+        context.history.assign(num_adj, 0);
+        context.killers.assign((size_t)graph.num_nodes + 1, UINT32_MAX);
+    }
+    SEARCH_FRAME *const frames = context.frames.data();
+    const bool use_table = context.table != NULL;
+    const bool use_bridges = context.bridges != NULL;
+    const bool use_tablebase = context.tablebase != NULL;
+    const bool use_series = context.series != NULL;
+    // a game started partway along a chain has to walk that one node by node
+    const uint32_t start_chain =
+        use_series ? context.series->interior_chain[curr_node] : SERIES_NONE;
+    size_t top = 0; // index of the frame for the position being searched
+    uint32_t move_top = 0; // first free move_stack entry
+    frames[0].node = (uint16_t)curr_node;
+    frames[0].edge = 0;
+    frames[0].move_key = 0;
+    frames[0].chain = SERIES_NONE;
+    frames[0].same_player = false;
+    // the edge counts (see count_node_edges) are kept up to date for the
+    // positions whose moves get ordered, which would otherwise look through
+    // every candidate's edges. Past those, and in label order, one look
+    // through the current node's edges is cheaper than keeping count
+    const uint_fast16_t count_plies = use_order ? context.order_plies : 0;
+    const uint_fast16_t start_open =
+        MAC ? count_open_edges(graph, edge_use_list, curr_node) : 0;
+    if (count_plies > 0) {
+        count_node_edges(context, graph, edge_use_list, node_use_list);
+    }
+    // undoes the move from from_node that got to a frame's node
+    auto take_back = [&](const SEARCH_FRAME &moved,
+                         const uint_fast16_t from_node) {
+        const bool counted = context.depth < count_plies;
+        node_use_list.set(moved.node, NODE_STATE::NOT_USED);
+        if (moved.chain == SERIES_NONE) [[likely]] {
+            edge_use_list.set(moved.edge, EDGE_STATE::NOT_USED);
+            if (counted) {
+                uncount_move(context, graph, from_node, moved.node);
+            }
+        } else {
+            const SERIES_CHAIN &chain = context.series->chains[moved.chain];
+            for (uint32_t index = 0; index < chain.length; index++) {
+                edge_use_list.set(context.series->edges[chain.edge_begin + index],
+                                  EDGE_STATE::NOT_USED);
+            }
+            // back from the far end, one node at a time
+            uint_fast16_t to_node = moved.node;
+            for (uint32_t index = chain.length - 1; index > 0; index--) {
+                const uint16_t passed =
+                    context.series->nodes[chain.node_begin + index - 1];
+                node_use_list.set(passed, NODE_STATE::NOT_USED);
+                if (counted) {
+                    uncount_move(context, graph, passed, to_node);
+                }
+                to_node = passed;
+            }
+            if (counted) {
+                uncount_move(context, graph, from_node, to_node);
+            }
+        }
+        context.hash ^= moved.move_key;
+        context.depth--;
+    };
+    bool entering = true; // true if frames[top] was just pushed
+    GAME_STATE result = GAME_STATE::LOSS_STATE;
+
+    while (true) {
+        SEARCH_FRAME &frame = frames[top];
+        bool settled = false;
+
+        if (entering) {
+            entering = false;
+            context.nodes++;
+            if (search_out_of_time(context)) [[unlikely]] {
+                // take back every move on the stack, then bail
+                for (; top > 0; top--) {
+                    take_back(frames[top], frames[top - 1].node);
+                }
+                return GAME_STATE::KILL_STATE;
+            }
+            frame.probed = false;
+            frame.ordered = false;
+            frame.tried = 0;
+            // residual graphs only shrink further into the game, so once one
+            // fits in the tablebase (and somehow wasn't in it) there's no point
+            // looking again
+            frame.small_residual = top > 0 && frames[top - 1].small_residual;
+
+            if constexpr (MAC) {
+                // every edge but the one we came in on is unused, past the
+                // top of the game
+                const uint_fast16_t open_edges =
+                    top == 0 ? start_open
+                             : graph.offsets[frame.node + 1] -
+                                   graph.offsets[frame.node] - 1;
+                if (context.depth < count_plies) {
+                    settled = context.cycle_edges[frame.node] > 0;
+                } else {
+                    for (uint32_t adj_index = graph.offsets[frame.node];
+                         adj_index < graph.offsets[frame.node + 1];
+                         adj_index++) {
+                        if (edge_use_list.get(graph.edge_ids[adj_index]) ==
+                                EDGE_STATE::NOT_USED &&
+                            node_use_list.get(graph.neighbors[adj_index]) ==
+                                NODE_STATE::USED) {
+                            settled = true;
+                            break;
+                        }
+                    }
+                }
+                if (settled) { // going back creates a cycle!
+                    result = GAME_STATE::WIN_STATE;
+                } else if (open_edges == 0) {
+                    result = GAME_STATE::LOSS_STATE;
+                    settled = true;
+                }
+            }
+
+            if (!settled && use_tablebase && !frame.small_residual) {
+                SMALL_GRAPH residual;
+                if (residual_graph<MAC>(graph, node_use_list, context,
+                                        frame.node,
+                                        context.tablebase->max_edges,
+                                        &residual)) {
+                    frame.small_residual = true;
+                    context.tb_probes++;
+                    const TT_RESULT stored =
+                        tb_lookup(*context.tablebase, residual, MAC);
+                    if (stored != TT_RESULT::EMPTY) {
+                        context.tb_hits++;
+                        result = from_tt_result(stored);
+                        settled = true;
+                    }
+                }
+            }
+
+            if (!settled && use_table && context.depth < context.table_plies) {
+                frame.key_words =
+                    context.use_regions
+                        ? region_key(context, top > 0 ? &frames[top - 1] : NULL,
+                                     frame, node_use_list, &frame.key_hash,
+                                     &frame.key_node)
+                        : search_key(context, frame.node, node_use_list,
+                                     &frame.key_hash, &frame.key_node);
+                const TT_RESULT stored =
+                    tt_probe(context.table, frame.key_hash, frame.key_node,
+                             frame.key_words);
+                if (stored != TT_RESULT::EMPTY) {
+                    result = from_tt_result(stored);
+                    settled = true;
+                } else {
+                    frame.probed = true;
+                }
+            }
+            frame.start_nodes = context.nodes;
+
+            if (!settled) {
+                if (use_order && context.depth < context.order_plies) {
+                    frame.ordered = true;
+                    frame.move_begin = move_top;
+                    frame.move_next = move_top;
+                    frame.move_end =
+                        move_top + order_moves<MAC>(
+                                       graph, edge_use_list, node_use_list,
+                                       context, frame.node,
+                                       &context.move_stack[move_top]);
+                    move_top = frame.move_end;
+                } else {
+                    frame.adj_index = graph.offsets[frame.node];
+                }
+            }
+        }
+
+        if (!settled) {
+            // look for the next move to try from this position
+            uint32_t move_adj = UINT32_MAX;
+            uint32_t move_chain = SERIES_NONE;
+            bool known_win = false; // a move is known to win without trying it
+            while (true) {
+                if (frame.ordered) {
+                    if (frame.move_next < frame.move_end) {
+                        move_adj = context.move_stack[frame.move_next++];
+                    }
+                } else {
+                    const uint32_t adj_end = graph.offsets[frame.node + 1];
+                    for (; frame.adj_index < adj_end; frame.adj_index++) {
+                        const uint_fast16_t curr_neighbor =
+                            graph.neighbors[frame.adj_index];
+                        const uint32_t curr_edge =
+                            graph.edge_ids[frame.adj_index];
+                        if (edge_use_list.get(curr_edge) ==
+                                EDGE_STATE::NOT_USED &&
+                            (MAC || node_use_list.get(curr_neighbor) ==
+                                        NODE_STATE::NOT_USED)) {
+                            move_adj = frame.adj_index++;
+                            break;
+                        }
+                    }
+                }
+                if (move_adj == UINT32_MAX) {
+                    break;
+                }
+                move_chain = use_series ? context.series->chain_of[move_adj]
+                                        : SERIES_NONE;
+                if (move_chain != SERIES_NONE &&
+                    context.series->chains[move_chain].id == start_chain) {
+                    move_chain = SERIES_NONE;
+                }
+
+                // the move's result for the player making it, if it's known
+                // without going down it
+                TT_RESULT known = TT_RESULT::EMPTY;
+                if (use_bridges &&
+                    context.bridge_results[move_adj] != TT_RESULT::EMPTY) {
+                    context.bridge_hits++;
+                    known = context.bridge_results[move_adj];
+                } else if (move_chain != SERIES_NONE &&
+                           node_use_list.get(
+                               context.series->chains[move_chain].end) ==
+                               NODE_STATE::USED) {
+                    // the chain's last node gets stuck next to a visited one,
+                    // which wins MAC and loses AAC for whoever's there
+                    context.chain_moves++;
+                    const bool odd =
+                        context.series->chains[move_chain].length % 2 == 1;
+                    known = MAC == odd ? TT_RESULT::WIN : TT_RESULT::LOSS;
+                } else if (MAC) {
+                    // whoever lands on a poisoned node closes a cycle: the
+                    // other player after a single move or an odd length
+                    // chain, the one moving after an even length chain
+                    const bool single = move_chain == SERIES_NONE;
+                    const bool same_player =
+                        !single &&
+                        context.series->chains[move_chain].length % 2 == 0;
+                    if (poisoned_node(
+                            context, graph, node_use_list,
+                            single ? graph.neighbors[move_adj]
+                                   : context.series->chains[move_chain].end,
+                            single ? frame.node : UINT16_MAX,
+                            context.depth < count_plies)) {
+                        context.poisoned_moves++;
+                        known = same_player ? TT_RESULT::WIN
+                                            : TT_RESULT::LOSS;
+                    }
+                }
+                if (known == TT_RESULT::EMPTY) {
+                    break;
+                }
+                frame.last_adj = move_adj;
+                frame.tried++;
+                if (known == TT_RESULT::WIN) {
+                    known_win = true;
+                    break;
+                }
+                move_adj = UINT32_MAX;
+            }
+            if (known_win) {
+                context.cutoffs++;
+                context.first_cutoffs += frame.tried == 1 ? 1 : 0;
+                if (frame.ordered &&
+                    context.move_order == MOVE_ORDER::HISTORY) {
+                    note_winning_move(context, frame.last_adj);
+                }
+                result = GAME_STATE::WIN_STATE;
+            } else if (move_adj != UINT32_MAX) { // make the move, go deeper
+                SEARCH_FRAME &child = frames[top + 1];
+                child.node = graph.neighbors[move_adj];
+                child.edge = graph.edge_ids[move_adj];
+                child.chain = move_chain;
+                child.same_player = false;
+                child.across_bridge =
+                    use_bridges && context.bridges->is_bridge[child.edge];
+                child.move_key = 0;
+                const bool counted = context.depth + 1 < count_plies;
+                if (move_chain != SERIES_NONE) { // all the way down the chain
+                    const SERIES_CHAIN &chain =
+                        context.series->chains[move_chain];
+                    context.chain_moves++;
+                    child.node = chain.end;
+                    child.same_player = chain.length % 2 == 0;
+                    for (uint32_t index = 0; index < chain.length; index++) {
+                        edge_use_list.set(
+                            context.series->edges[chain.edge_begin + index],
+                            EDGE_STATE::USED);
+                    }
+                    uint_fast16_t from_node = frame.node;
+                    for (uint32_t index = 0; index + 1 < chain.length;
+                         index++) {
+                        const uint16_t passed =
+                            context.series->nodes[chain.node_begin + index];
+                        node_use_list.set(passed, NODE_STATE::USED);
+                        if (counted) {
+                            count_move(context, graph, from_node, passed);
+                        }
+                        from_node = passed;
+                        child.move_key ^=
+                            use_table ? context.zobrist->visited_keys[passed]
+                                      : 0;
+                    }
+                    if (counted) {
+                        count_move(context, graph, from_node, child.node);
+                    }
+                } else if (counted) {
+                    count_move(context, graph, frame.node, child.node);
+                }
+                child.move_key ^=
+                    use_table ? zobrist_move_key(*context.zobrist, frame.node,
+                                                 child.node)
+                              : 0;
+                frame.last_adj = move_adj;
+                frame.tried++;
+                edge_use_list.set(child.edge, EDGE_STATE::USED);
+                node_use_list.set(child.node, NODE_STATE::USED);
+                context.hash ^= child.move_key;
+                context.depth++;
+                top++;
+                entering = true;
+                continue;
+            } else { // out of moves without finding a good one
+                result = GAME_STATE::LOSS_STATE;
+            }
+        }
+
+        // this position's done, pass its result back up the stack. If that
+        // makes the move to it a win for the player a ply up, their position
+        // is a WIN and done too, otherwise it goes on to its next move. The
+        // player a ply up is the other one, unless an even length chain got
+        // here
+        while (true) {
+            SEARCH_FRAME &done = frames[top];
+            if (done.probed) {
+                tt_store(context.table, done.key_hash, done.key_node,
+                         done.key_words, to_tt_result(result),
+                         context.nodes - done.start_nodes + 1);
+                done.probed = false;
+            }
+            if (done.ordered) {
+                move_top = done.move_begin;
+                done.ordered = false;
+            }
+            if (top == 0) {
+                return result;
+            }
+            const GAME_STATE move_result =
+                done.same_player ? result
+                : result == GAME_STATE::LOSS_STATE ? GAME_STATE::WIN_STATE
+                                                   : GAME_STATE::LOSS_STATE;
+            if (done.across_bridge) {
+                context.bridge_results[frames[top - 1].last_adj] =
+                    to_tt_result(move_result);
+            }
+            take_back(done, frames[top - 1].node);
+            top--;
+            if (move_result == GAME_STATE::WIN_STATE) {
+                SEARCH_FRAME &winner = frames[top];
+                context.cutoffs++;
+                context.first_cutoffs += winner.tried == 1 ? 1 : 0;
+                if (winner.ordered &&
+                    context.move_order == MOVE_ORDER::HISTORY) {
+                    note_winning_move(context, winner.last_adj);
+                }
+                result = GAME_STATE::WIN_STATE;
+                continue;
+            }
+            break;
+        }
+    }
+}
+
+/****************************************************************************
+ * play_MAC_iterative/ play_AAC_iterative
+ *
+ * - Plays the MAC/ AAC game without recursion, see play_quiet_iterative for the
+ * parameters
+ ****************************************************************************/
+GAME_STATE
+play_MAC_iterative(const uint_fast16_t curr_node,
+                   const ADJACENCY_CSR &__restrict graph,
+                   PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                   PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                   SEARCH_CONTEXT &__restrict context) {
+    return play_quiet_iterative<true>(curr_node, graph, edge_use_list,
+                                      node_use_list, context);
+}
+
+GAME_STATE
+play_AAC_iterative(const uint_fast16_t curr_node,
+                   const ADJACENCY_CSR &__restrict graph,
+                   PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                   PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                   SEARCH_CONTEXT &__restrict context) {
+    return play_quiet_iterative<false>(curr_node, graph, edge_use_list,
+                                       node_use_list, context);
+}
+
+/****************************************************************************
+ * play_all_starts_quiet
+ *
+ * - Quietly plays the requested game from every starting node in the graph
+ * - Starting nodes in the same automorphism orbit always give the same result,
+ * so only the smallest node in each orbit is actually played and its result is
+ * copied to the rest. A vertex-transitive graph only takes a single game
+ *
+ * Parameters :
+ * - play_MAC : true to play MAC, false to play AAC
+ * - graph : reference to the CSR form of the graph in question
+ * - orbit_rep : for each node, the node its result should be taken from (see
+ * find_orbits)
+ * - context : an already set up search context. Its table, if any, is shared
+ * between the games, and its counters add up over all of them
+ * - results_out : where the result for each starting node is written
+ * (KILL_STATE for any that ran past the context's deadline)
+ *
+ * Returns :
+ * - size_t : the number of games actually played
+ ****************************************************************************/
+size_t play_all_starts_quiet(const bool play_MAC,
+                             const ADJACENCY_CSR &__restrict graph,
+                             const std::vector<uint16_t> &__restrict orbit_rep,
+                             SEARCH_CONTEXT &__restrict context,
+                             std::vector<GAME_STATE> *__restrict results_out) {
+    PACKED_STATES<EDGE_STATE> edge_use_list(graph.num_edges);
+    PACKED_STATES<NODE_STATE> node_use_list(graph.num_nodes);
+    size_t num_games = 0;
+
+    results_out->assign(graph.num_nodes, GAME_STATE::LOSS_STATE);
+    for (uint_fast16_t start = 0; start < graph.num_nodes; start++) {
+        if (orbit_rep[start] != start) { // orbit's smallest node came first
+            (*results_out)[start] = (*results_out)[orbit_rep[start]];
+            continue;
+        }
+
+        restart_search_context(&context, start);
+        node_use_list.set(start, NODE_STATE::USED);
+        (*results_out)[start] =
+            play_MAC ? play_MAC_iterative(start, graph, edge_use_list,
+                                          node_use_list, context)
+                     : play_AAC_iterative(start, graph, edge_use_list,
+                                          node_use_list, context);
+        node_use_list.set(start, NODE_STATE::NOT_USED);
+        num_games++;
+    }
+
+    return num_games;
+}
+
+/****************************************************************************
+ * play_AAC_matching
+ *
+ * - Solves AAC from every starting node at once without searching, using a
+ * maximum matching (see Matching.h): the first player wins from exactly the
+ * nodes that every maximum matching covers
+ * - Runs in polynomial time, so it's the way to go for anything but checking
+ * the search against it. That also makes it the only way games get played on
+ * graphs too big for 16 bit node labels (WIDE_ADJACENCY_CSR)
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph in question
+ * - results_out : where the result for each starting node is written
+ *
+ * Returns :
+ * - uint32_t : the number of edges in a maximum matching of the graph
+ ****************************************************************************/
+template <typename NODE_T>
+uint32_t play_AAC_matching(const ADJACENCY_CSR_T<NODE_T> &__restrict graph,
+                           std::vector<GAME_STATE> *__restrict results_out) {
+    std::vector<bool> inessential;
+    const uint32_t matching_size = find_inessential_nodes(graph, &inessential);
+
+    results_out->resize(graph.num_nodes);
+    for (uint_fast32_t start = 0; start < graph.num_nodes; start++) {
+        (*results_out)[start] = inessential[start] ? GAME_STATE::LOSS_STATE
+                                                   : GAME_STATE::WIN_STATE;
+    }
+
+    return matching_size;
+}
@@ -0,0 +1,464 @@
+#pragma once
+/*
+ *
+ * - This file holds a depth first proof number search (df-pn, Nagai 2002)
+ * version of the quiet MAC game
+ * - MAC trees are very lopsided: some lines close a cycle within a few moves,
+ * others run through most of the graph. A plain depth first search commits to
+ * whichever move comes first and searches all the way down it before it ever
+ * looks at the next one, even when the next one would've been settled in a
+ * couple of moves
+ * - Proof number search instead keeps two numbers for every position, from the
+ * point of view of the player to move there:
+ *	- the proof number: how many more positions at least have to be solved to
+ *	show the player to move wins
+ *	- the disproof number: the same, to show they lose
+ * A position's proof number is the smallest disproof number among its moves
+ * (winning takes one move that loses for the opponent) and its disproof number
+ * is the sum of its moves' proof numbers (losing takes every move winning for
+ * the opponent). The search always goes down the move with the smallest
+ * disproof number, i.e. the one closest to a proof, so cheap refutations get
+ * found before expensive lines get searched
+ * - df-pn does this depth first with thresholds instead of keeping the whole
+ * tree around: a position is only searched until one of its numbers reaches
+ * the threshold handed down to it, and everything it learns is kept in a table
+ * of its own (PN_TABLE) keyed the same way as the transposition table (see
+ * Transposition_Table.h). The table's what makes it work, since a position
+ * gets gone back into every time the search's attention comes back to it
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Cycle_Games.h"
+#include "Packed_State.h"
+#include "Transposition_Table.h"
+
+// Proof/ disproof number of a position that's been solved. Sums of proof
+// numbers stop just short of it, so it only ever means solved
+#define PN_INFINITY UINT64_MAX
+// How often (in positions searched, minus 1, power of 2) df-pn checks the clock
+#define PN_CLOCK_MASK 0xFFF
+
+// The table's buckets, replacement policy and key layout are the same as the
+// transposition table's (see Transposition_Table.h), just with proof and
+// disproof numbers where the result would be
+typedef struct PN_ENTRY {
+    uint64_t hash = 0;
+    uint32_t work = 0; // positions searched below the entry, saturating
+    uint32_t curr_node = 0;
+    uint64_t proof = 0;
+    uint64_t disproof = 0; // both 0 for an empty entry
+} PN_ENTRY;
+
+typedef struct PN_TABLE {
+    std::vector<PN_ENTRY> entries;
+    std::vector<uint64_t> key_words;
+    size_t words_per_key = 0;
+    size_t bucket_mask = 0; // number of buckets - 1 (always a power of 2)
+} PN_TABLE;
+
+// One of a position's moves, and what's known about the position it leads to
+typedef struct PN_CHILD {
+    uint32_t adj_index = 0; // CSR index of the move
+    uint64_t proof = 1;     // for the player moving next
+    uint64_t disproof = 1;
+} PN_CHILD;
+
+typedef struct DFPN_CONTEXT {
+    const ZOBRIST_KEYS *zobrist = NULL;
+    PN_TABLE *table = NULL;
+    uint64_t hash = 0;  // Zobrist hash of the current position
+    uint64_t nodes = 0; // positions searched so far
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
+    bool timed_out = false;
+    std::vector<PN_CHILD> children; // each searched position's moves, by ply
+} DFPN_CONTEXT;
+
+/****************************************************************************
+ * pn_init
+ *
+ * - Allocates a proof number table that fits in (roughly) the requested amount
+ * of memory, for positions on a graph with the given number of nodes
+ *
+ * Parameters :
+ * - table : the table to set up. Any previous contents are thrown out
+ * - size_mb : the memory budget for the table, in megabytes
+ * - num_nodes : the number of nodes in the graph being played on
+ *
+ * Returns :
+ * - bool : true if a table with at least one bucket was allocated
+ ****************************************************************************/
+bool pn_init(PN_TABLE *__restrict table, const size_t size_mb,
+             const size_t num_nodes) {
+    *table = PN_TABLE{};
+    table->words_per_key = (num_nodes + 63) / 64;
+
+    const size_t bucket_bytes =
+        TT_BUCKET_SIZE * (sizeof(PN_ENTRY) + table->words_per_key * 8);
+    size_t num_buckets = (size_mb * 1024 * 1024) / bucket_bytes;
+    if (num_buckets == 0) {
+        return false;
+    }
+    size_t pow_2 = 1;
+    while (pow_2 * 2 <= num_buckets) {
+        pow_2 *= 2;
+    }
+    num_buckets = pow_2;
+
+    table->entries.resize(num_buckets * TT_BUCKET_SIZE);
+    table->key_words.resize(num_buckets * TT_BUCKET_SIZE *
+                            table->words_per_key);
+    table->bucket_mask = num_buckets - 1;
+    return true;
+}
+
+/****************************************************************************
+ * pn_clear
+ *
+ * - Empties out a table without giving up its memory
+ *
+ * Parameters :
+ * - table : the table to clear
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void pn_clear(PN_TABLE *__restrict table) {
+    std::fill(table->entries.begin(), table->entries.end(), PN_ENTRY{});
+}
+
+/****************************************************************************
+ * pn_find
+ *
+ * - Helper function, finds a position's entry in the table
+ *
+ * Parameters :
+ * - table : the table to look in
+ * - hash : the position's Zobrist hash
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ *
+ * Returns :
+ * - PN_ENTRY * : the position's entry, or NULL if it isn't in the table
+ ****************************************************************************/
+inline PN_ENTRY *pn_find(PN_TABLE *__restrict table, const uint64_t hash,
+                         const uint32_t curr_node,
+                         const uint64_t *__restrict node_words) {
+    const size_t bucket = (hash & table->bucket_mask) * TT_BUCKET_SIZE;
+    for (size_t slot = bucket; slot < bucket + TT_BUCKET_SIZE; slot++) {
+        PN_ENTRY &entry = table->entries[slot];
+        if (entry.hash == hash && entry.curr_node == curr_node &&
+            (entry.proof | entry.disproof) != 0 &&
+            std::memcmp(&table->key_words[slot * table->words_per_key],
+                        node_words, table->words_per_key * 8) == 0) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+/****************************************************************************
+ * pn_store
+ *
+ * - Records a position's proof and disproof numbers, following the
+ * transposition table's replacement policy
+ *
+ * Parameters :
+ * - table : the table to store in
+ * - hash : the position's Zobrist hash
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ * - proof, disproof : the position's numbers
+ * - work : how many positions have been searched below the position
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void pn_store(PN_TABLE *__restrict table, const uint64_t hash,
+              const uint32_t curr_node,
+              const uint64_t *__restrict node_words, const uint64_t proof,
+              const uint64_t disproof, const uint64_t work) {
+    const uint32_t entry_work = work > UINT32_MAX ? UINT32_MAX : (uint32_t)work;
+    PN_ENTRY *entry = pn_find(table, hash, curr_node, node_words);
+    if (entry != NULL) {
+        entry->proof = proof;
+        entry->disproof = disproof;
+        entry->work = std::max(entry->work, entry_work);
+        return;
+    }
+
+    const size_t bucket = (hash & table->bucket_mask) * TT_BUCKET_SIZE;
+    const size_t words = table->words_per_key;
+    size_t target = bucket + 1; // "always replace" slot by default
+    if (entry_work >= table->entries[bucket].work) {
+        target = bucket;
+        // demote the old work preferred entry to the always replace slot
+        table->entries[bucket + 1] = table->entries[bucket];
+        std::memcpy(&table->key_words[(bucket + 1) * words],
+                    &table->key_words[bucket * words], words * 8);
+    }
+    table->entries[target] = {hash, entry_work, curr_node, proof, disproof};
+    std::memcpy(&table->key_words[target * words], node_words, words * 8);
+}
+
+/****************************************************************************
+ * init_dfpn_context
+ *
+ * - Sets up a df-pn context for a game starting at the given node
+ *
+ * Parameters :
+ * - context : the context to set up
+ * - zobrist : the graph's Zobrist keys
+ * - table : the proof number table to use
+ * - start_node : the node the game starts on
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void init_dfpn_context(DFPN_CONTEXT *__restrict context,
+                       const ZOBRIST_KEYS *zobrist, PN_TABLE *table,
+                       const uint_fast16_t start_node) {
+    *context = DFPN_CONTEXT{};
+    context->zobrist = zobrist;
+    context->table = table;
+    context->hash = zobrist_start_key(*zobrist, start_node);
+}
+
+/****************************************************************************
+ * pn_add
+ *
+ * - Lil helper function, adds up proof numbers, stopping just short of
+ * PN_INFINITY unless one of them already is
+ *
+ * Parameters :
+ * - sum, value : the numbers to add
+ *
+ * Returns :
+ * - uint64_t : the sum
+ ****************************************************************************/
+inline uint64_t pn_add(const uint64_t sum, const uint64_t value) {
+    if (sum == PN_INFINITY || value == PN_INFINITY) {
+        return PN_INFINITY;
+    }
+    return value >= PN_INFINITY - 1 - sum ? PN_INFINITY - 1 : sum + value;
+}
+
+/****************************************************************************
+ * dfpn_evaluate
+ *
+ * - Works out what's known about the position a move leads to, while the move
+ * is made: solved right away if the player moving next can close a cycle or
+ * is stuck, otherwise whatever the table has, otherwise 1 and 1
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph being played on
+ * - edge_use_list : the current edge use list
+ * - node_use_list : the current node use list
+ * - context : the df-pn context of the current game
+ * - curr_node : the position's current node
+ * - child : where the numbers are written
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void dfpn_evaluate(const ADJACENCY_CSR &__restrict graph,
+                   const PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                   const PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                   DFPN_CONTEXT &__restrict context,
+                   const uint_fast16_t curr_node, PN_CHILD *__restrict child) {
+    uint_fast16_t open_edges = 0;
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        if (edge_use_list.get(graph.edge_ids[adj_index]) ==
+            EDGE_STATE::NOT_USED) {
+            open_edges++;
+            if (node_use_list.get(graph.neighbors[adj_index]) ==
+                NODE_STATE::USED) { // going back creates a cycle!
+                child->proof = 0;
+                child->disproof = PN_INFINITY;
+                return;
+            }
+        }
+    }
+    if (open_edges == 0) {
+        child->proof = PN_INFINITY;
+        child->disproof = 0;
+        return;
+    }
+
+    const PN_ENTRY *entry =
+        pn_find(context.table, context.hash, (uint32_t)curr_node,
+                node_use_list.words.data());
+    child->proof = entry != NULL ? entry->proof : 1;
+    child->disproof = entry != NULL ? entry->disproof : open_edges;
+}
+
+/****************************************************************************
+ * dfpn_search
+ *
+ * - Searches a position (one that isn't solved outright, see dfpn_evaluate)
+ * until its proof number reaches proof_limit or its disproof number reaches
+ * disproof_limit, whichever comes first
+ * - Each time around, the move closest to a proof (smallest disproof number)
+ * gets searched, with limits picked so that it's handed back as soon as it
+ * either stops being the best move or gets this position to one of its limits
+ *
+ * Parameters :
+ * - curr_node : the position's current node
+ * - graph : reference to the CSR form of the graph being played on
+ * - edge_use_list : the current edge use list
+ * - node_use_list : the current node use list
+ * - context : the df-pn context of the current game
+ * - proof_limit, disproof_limit : the limits
+ * - numbers : the position's numbers, on the way in what's known so far, on
+ * the way out what the search found
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void dfpn_search(const uint_fast16_t curr_node,
+                 const ADJACENCY_CSR &__restrict graph,
+                 PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                 PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                 DFPN_CONTEXT &__restrict context, const uint64_t proof_limit,
+                 const uint64_t disproof_limit, PN_CHILD *__restrict numbers) {
+    context.nodes++;
+    if (context.has_deadline && (context.nodes & PN_CLOCK_MASK) == 0 &&
+        std::chrono::steady_clock::now() >= context.deadline) [[unlikely]] {
+        context.timed_out = true;
+    }
+    if (context.timed_out) [[unlikely]] {
+        return;
+    }
+    const uint64_t start_nodes = context.nodes;
+
+    // every move goes to an unvisited node, the caller's already checked
+    // there's no cycle to close
+    const size_t begin = context.children.size();
+    for (uint32_t adj_index = graph.offsets[curr_node];
+         adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+        const uint32_t edge = graph.edge_ids[adj_index];
+        if (edge_use_list.get(edge) == EDGE_STATE::USED) {
+            continue;
+        }
+        const uint16_t neighbor = graph.neighbors[adj_index];
+        const uint64_t move_key =
+            zobrist_move_key(*context.zobrist, curr_node, neighbor);
+        PN_CHILD child;
+        child.adj_index = adj_index;
+        edge_use_list.set(edge, EDGE_STATE::USED);
+        node_use_list.set(neighbor, NODE_STATE::USED);
+        context.hash ^= move_key;
+        dfpn_evaluate(graph, edge_use_list, node_use_list, context, neighbor,
+                      &child);
+        edge_use_list.set(edge, EDGE_STATE::NOT_USED);
+        node_use_list.set(neighbor, NODE_STATE::NOT_USED);
+        context.hash ^= move_key;
+        context.children.push_back(child);
+    }
+    const size_t end = context.children.size();
+
+    while (true) {
+        uint64_t proof = PN_INFINITY;
+        uint64_t disproof = 0;
+        uint64_t second_best = PN_INFINITY; // second smallest disproof number
+        size_t best = begin;
+        for (size_t index = begin; index < end; index++) {
+            const PN_CHILD &child = context.children[index];
+            if (child.disproof < proof) {
+                second_best = proof;
+                proof = child.disproof;
+                best = index;
+            } else if (child.disproof < second_best) {
+                second_best = child.disproof;
+            }
+            disproof = pn_add(disproof, child.proof);
+        }
+        numbers->proof = proof;
+        numbers->disproof = disproof;
+        if (proof >= proof_limit || disproof >= disproof_limit ||
+            context.timed_out) {
+            break;
+        }
+
+        // the best move's limits: it's handed back once its disproof number
+        // passes the second best's by a quarter (rather than by 1, which has
+        // the search hop back and forth between two close moves), or once the
+        // rest of this position's disproof number plus its proof number
+        // reaches the limit
+        PN_CHILD &child = context.children[best];
+        const uint64_t child_proof_limit =
+            disproof_limit - disproof + child.proof;
+        const uint64_t child_disproof_limit = std::min(
+            proof_limit,
+            second_best >= PN_INFINITY / 2 ? PN_INFINITY
+                                           : second_best + second_best / 4 + 1);
+        const uint32_t edge = graph.edge_ids[child.adj_index];
+        const uint16_t neighbor = graph.neighbors[child.adj_index];
+        const uint64_t move_key =
+            zobrist_move_key(*context.zobrist, curr_node, neighbor);
+        edge_use_list.set(edge, EDGE_STATE::USED);
+        node_use_list.set(neighbor, NODE_STATE::USED);
+        context.hash ^= move_key;
+        PN_CHILD numbers_found = child;
+        dfpn_search(neighbor, graph, edge_use_list, node_use_list, context,
+                    child_proof_limit, child_disproof_limit, &numbers_found);
+        edge_use_list.set(edge, EDGE_STATE::NOT_USED);
+        node_use_list.set(neighbor, NODE_STATE::NOT_USED);
+        context.hash ^= move_key;
+        // the search underneath pushed onto children, so child might not be
+        // good anymore
+        context.children[best].proof = numbers_found.proof;
+        context.children[best].disproof = numbers_found.disproof;
+    }
+
+    context.children.resize(begin);
+    if (!context.timed_out) {
+        pn_store(context.table, context.hash, (uint32_t)curr_node,
+                 node_use_list.words.data(), numbers->proof,
+                 numbers->disproof, context.nodes - start_nodes);
+    }
+}
+
+/****************************************************************************
+ * play_MAC_dfpn
+ *
+ * - Quietly plays the MAC game with df-pn (see the top of this file)
+ * - Gives the same result as play_MAC_quiet, it just gets there by searching
+ * the game tree in a different order
+ *
+ * Parameters :
+ * - curr_node : the starting node
+ * - graph : reference to the CSR form of the graph being played on
+ * - edge_use_list : the edge use list, nothing used yet
+ * - node_use_list : the node use list, only the starting node visited
+ * - context : the df-pn context of the current game
+ *
+ * Returns :
+ * - GAME_STATE : the result for the player moving first, or KILL_STATE if
+ * context's deadline passed first
+ ****************************************************************************/
+GAME_STATE play_MAC_dfpn(const uint_fast16_t curr_node,
+                         const ADJACENCY_CSR &__restrict graph,
+                         PACKED_STATES<EDGE_STATE> &__restrict edge_use_list,
+                         PACKED_STATES<NODE_STATE> &__restrict node_use_list,
+                         DFPN_CONTEXT &__restrict context) {
+    PN_CHILD root;
+    dfpn_evaluate(graph, edge_use_list, node_use_list, context, curr_node,
+                  &root);
+    while (root.proof != 0 && root.disproof != 0 && !context.timed_out) {
+        dfpn_search(curr_node, graph, edge_use_list, node_use_list, context,
+                    PN_INFINITY, PN_INFINITY, &root);
+    }
+    if (context.timed_out) {
+        return GAME_STATE::KILL_STATE;
+    }
+    return root.proof == 0 ? GAME_STATE::WIN_STATE : GAME_STATE::LOSS_STATE;
+}
@@ -1,350 +1,801 @@
 #pragma once
-#include "Cycle_Games.h"
-#include "Threadpool.h"
-
 /*
  *
- * - So as far as I can tell the code below "works", but isn't really usable...
- * - Each separate job needs its own private copy of the node_use and edge_use
- *vectors and creating those copies gets very expensive and we typically run out
- *of memory
+ * - This file holds the multithreaded versions of the quiet games
+ * - The old version of this code handed every move at the root to a thread
+ * pool along with its own copy of the edge and node use lists. The copies got
+ * very expensive (and ran us out of memory), and one job per root move gave
+ * terrible load balancing, since one of the subtrees is usually way bigger
+ * than the rest
  *
- * - For graphs small enough so that we don't bottom out the stack, the
- *threading overhead is > 10x
- * - For graphs where threading would help, we crash because of the
- *afforementioned memory issues
+ * - This version is a "Young Brothers Wait" (YBW) search with work stealing:
+ *		- Each worker thread owns exactly one edge use list and one node use
+ *list for the whole game, and plays moves on it with the same make/ unmake
+ *scheme as the single threaded code. Nothing gets copied per job
+ *		- At a node in the first split_plies moves of the game, the first move
+ *is searched serially (the "eldest brother"). If that doesn't settle things,
+ *the node becomes a split point: the rest of its moves are put up for grabs,
+ *and any idle worker can steal one
+ *		- A split point only stores the moves that lead to it from the start
+ *(there's at most split_plies of them), so a worker that steals from it gets
+ *its own lists into the right position by taking back/ replaying moves until
+ *its move history matches. That's a handful of bit flips, not a copy
+ *		- As soon as any move at a split point is found to win, the split point
+ *is marked as won. Every worker searching underneath it notices within
+ *PARALLEL_CANCEL_MASK + 1 positions and unwinds with KILL_STATE
+ *		- An owner that runs out of moves at its split point while other
+ *workers are still searching there helps out with work from underneath its
+ *own split point. If there isn't any, it sleeps until the last helper leaves
+ *		- The workers run as jobs on a ThreadPool, so the threads stick around
+ *from one game to the next. Workers with nothing to steal sleep instead of
+ *spinning, and the calling thread just blocks until the game's decided
  *
- * - Might be worth looking into heap-allocating the vectors and seeing if that
- *works, but I'll try that later...
- *		- looking at the docs vectors may already be heap allocated, so I don't
- *think this is a solution
+ * - Each worker also has a search context of its own, for what the single
+ * threaded search keeps per game but the workers can't share: the edge counts
+ * (see count_node_edges), and the scratch space and history for move
+ * ordering. With those, every position's moves are tried in the chosen move
+ * order (see order_moves), and MAC moves onto poisoned nodes (see
+ * poisoned_node) are never gone down. A split point's moves are the ones its
+ * owner put in order, so the eldest brother is the most promising move
  *
- * - I'll leave this code in case I think of a solution later...
+ * - The transposition table isn't used here, since it isn't safe to share
+ * between threads, and neither are the reductions that lean on it or on
+ * per-game tables (region keys, bridges, chains, the tablebase). So a threaded
+ * game usually searches quite a few more positions than a single threaded one.
+ * Symmetric starting nodes can still be skipped by the caller (see
+ * find_orbits)
  *
  */
 
-GAME_STATE
-play_MAC_recur(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-               const std::vector<Adjacency_Info> &__restrict adj_matrix,
-               std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-               std::vector<NODE_STATE> &__restrict node_use_list,
-               std::stop_source token_source) {
-    std::stop_token stoken = token_source.get_token();
-    if (stoken.stop_requested()) {
-        return GAME_STATE::KILL_STATE;
-    }
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <vector>
 
-    uint_fast16_t open_edges = 0; // stores the number of available edges we can
-                                  // move along from curr_node
-    GAME_STATE
-        move_result; // temporarily store the result of a recursive call here
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
-            open_edges++;
-            if (node_use_list[curr_neighbor] ==
-                NODE_STATE::USED) { // if the neighbor has been previously
-                                    // visited, going back creates a cycle!
-                return GAME_STATE::WIN_STATE;
-            }
+#include "Adjacency_Matrix.h"
+#include "Cycle_Games.h"
+#include "Packed_State.h"
+#include "ThreadPool.h"
+
+// Nodes this many moves or fewer into the game can become split points. Below
+// that, workers just search serially
+#define PARALLEL_SPLIT_PLIES 16
+// How often (in positions searched, minus 1, power of 2) a worker checks
+// whether the subtree it's searching is still wanted
+#define PARALLEL_CANCEL_MASK 0x3FF
+
+struct PARALLEL_WORKER;
+
+// A node whose moves are being searched by several workers at once. Lives on
+// its owner's stack until every worker searching one of its moves is done
+typedef struct SPLIT_POINT {
+    const SPLIT_POINT *parent = NULL; // enclosing split point, NULL at the top
+    PARALLEL_WORKER *owner = NULL;    // worker whose stack it lives on
+    uint_fast16_t depth = 0;          // number of moves from the start
+    uint16_t path_nodes[PARALLEL_SPLIT_PLIES + 1]; // start node, then moves
+    uint32_t path_edges[PARALLEL_SPLIT_PLIES];
+    // the node's moves (CSR indices) in order, on the owner's move stack
+    const uint32_t *moves = NULL;
+    uint32_t num_moves = 0;
+    std::atomic<uint32_t> next_move = 0;    // next entry of moves up for grabs
+    std::atomic<uint32_t> helpers = 0;      // non-owners searching a move here
+    std::atomic<bool> won = false;          // a winning move has been found
+} SPLIT_POINT;
+
+// Everything one worker thread owns
+typedef struct PARALLEL_WORKER {
+    size_t index = 0; // position in PARALLEL_SEARCH::workers
+    PACKED_STATES<EDGE_STATE> edge_use_list;
+    PACKED_STATES<NODE_STATE> node_use_list;
+    // the moves that got edge_use_list/ node_use_list into their current
+    // state, only kept up to date for the first PARALLEL_SPLIT_PLIES moves
+    std::vector<uint16_t> path_nodes;
+    std::vector<uint32_t> path_edges;
+    // edge counts, move ordering and the number of moves made, for the
+    // position edge_use_list/ node_use_list are in
+    SEARCH_CONTEXT context;
+    uint32_t move_top = 0; // first free entry of context.move_stack
+    uint64_t nodes = 0;  // positions searched by this worker
+    uint64_t splits = 0; // split points opened by this worker
+    uint64_t steals = 0; // moves taken from other workers' split points
+    // bumped whenever a helper leaves one of this worker's split points, for
+    // the worker to sleep on while it waits for them
+    std::atomic<uint32_t> wake = 0;
+
+    std::mutex split_mutex;
+    std::deque<SPLIT_POINT *> split_points; // open split points, oldest first
+} PARALLEL_WORKER;
+
+// State shared by every worker in a game
+typedef struct PARALLEL_SEARCH {
+    const ADJACENCY_CSR *graph = NULL;
+    std::vector<std::unique_ptr<PARALLEL_WORKER>> workers;
+    uint_fast16_t split_plies = PARALLEL_SPLIT_PLIES;
+
+    std::atomic<bool> stop = false; // ran past the deadline
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    // idle workers sleep until work_epoch changes (new split point) or the
+    // game's decided
+    std::atomic<uint32_t> idle = 0;
+    std::atomic<uint64_t> work_epoch = 0;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+} PARALLEL_SEARCH;
+
+// Counters from a finished multithreaded game
+typedef struct PARALLEL_STATS {
+    size_t threads = 0;
+    uint64_t nodes = 0;
+    uint64_t splits = 0;
+    uint64_t steals = 0;
+} PARALLEL_STATS;
+
+/****************************************************************************
+ * parallel_cancelled
+ *
+ * - Lil helper function, checks whether the subtree underneath a split point
+ * is still worth searching: it isn't if the game ran past its deadline, or if
+ * a winning move was already found at that split point or any enclosing one
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - split : the innermost split point enclosing the subtree, or NULL
+ *
+ * Returns :
+ * - bool : true if the subtree should be abandoned
+ ****************************************************************************/
+inline bool parallel_cancelled(const PARALLEL_SEARCH &__restrict search,
+                               const SPLIT_POINT *split) {
+    if (search.stop.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    for (; split != NULL; split = split->parent) {
+        if (split->won.load(std::memory_order_relaxed)) {
+            return true;
         }
     }
+    return false;
+}
 
-    if (open_edges == 0) { // if there are 0 open edges, we're in a loss state
-        return GAME_STATE::LOSS_STATE;
+/****************************************************************************
+ * parallel_tick
+ *
+ * - Counts one position for a worker, and every so often checks whether the
+ * worker should give up on what it's searching
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - worker : the worker
+ * - split : the innermost split point enclosing the current position, or NULL
+ *
+ * Returns :
+ * - bool : true if the current subtree should be abandoned
+ ****************************************************************************/
+inline bool parallel_tick(PARALLEL_SEARCH &__restrict search,
+                          PARALLEL_WORKER &__restrict worker,
+                          const SPLIT_POINT *split) {
+    if ((++worker.nodes & PARALLEL_CANCEL_MASK) != 0) [[likely]] {
+        return false;
+    }
+    if (search.has_deadline && (worker.nodes & SEARCH_CLOCK_MASK) == 0 &&
+        std::chrono::steady_clock::now() >= search.deadline) {
+        search.stop.store(true, std::memory_order_relaxed);
     }
+    return parallel_cancelled(search, split);
+}
 
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
-            // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result =
-                play_MAC_recur(curr_neighbor, num_nodes, adj_matrix,
-                               edge_use_matrix, node_use_list, token_source);
-            // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
-            if (move_result ==
-                GAME_STATE::LOSS_STATE) { // if the move puts the game into a
-                                          // loss state, then the current state
-                                          // is a win state
-                return GAME_STATE::WIN_STATE;
-            } else if (move_result == GAME_STATE::KILL_STATE) {
-                return GAME_STATE::KILL_STATE;
+/****************************************************************************
+ * parallel_make_move/ parallel_take_back
+ *
+ * - Lil helper functions, play a move from from_node to the unvisited node
+ * to_node on a worker's lists (keeping its edge counts and depth up to date),
+ * and take it back
+ ****************************************************************************/
+inline void parallel_make_move(const ADJACENCY_CSR &__restrict graph,
+                               PARALLEL_WORKER &__restrict worker,
+                               const uint_fast16_t from_node,
+                               const uint_fast16_t to_node,
+                               const uint32_t edge) {
+    worker.edge_use_list.set(edge, EDGE_STATE::USED);
+    worker.node_use_list.set(to_node, NODE_STATE::USED);
+    count_move(worker.context, graph, from_node, to_node);
+    worker.context.depth++;
+}
+
+inline void parallel_take_back(const ADJACENCY_CSR &__restrict graph,
+                               PARALLEL_WORKER &__restrict worker,
+                               const uint_fast16_t from_node,
+                               const uint_fast16_t to_node,
+                               const uint32_t edge) {
+    worker.edge_use_list.set(edge, EDGE_STATE::NOT_USED);
+    worker.node_use_list.set(to_node, NODE_STATE::NOT_USED);
+    uncount_move(worker.context, graph, from_node, to_node);
+    worker.context.depth--;
+}
+
+/****************************************************************************
+ * sync_worker_state
+ *
+ * - Gets a worker's edge and node use lists (and edge counts) into the
+ * position at a split point, by taking back the worker's moves until its move
+ * history agrees with the split point's and then playing the split point's
+ * remaining moves
+ *
+ * Parameters :
+ * - graph : the graph
+ * - worker : the worker, whose move history can't be deeper than
+ * PARALLEL_SPLIT_PLIES moves
+ * - split : the split point
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void sync_worker_state(const ADJACENCY_CSR &__restrict graph,
+                       PARALLEL_WORKER &__restrict worker,
+                       const SPLIT_POINT &__restrict split) {
+    // both histories start from the same node
+    size_t common = 1;
+    while (common < worker.path_nodes.size() && common <= split.depth &&
+           worker.path_nodes[common] == split.path_nodes[common]) {
+        common++;
+    }
+    while (worker.path_nodes.size() > common) {
+        const size_t last = worker.path_nodes.size() - 1;
+        parallel_take_back(graph, worker, worker.path_nodes[last - 1],
+                           worker.path_nodes[last], worker.path_edges.back());
+        worker.path_edges.pop_back();
+        worker.path_nodes.pop_back();
+    }
+    for (size_t move = common; move <= split.depth; move++) {
+        parallel_make_move(graph, worker, split.path_nodes[move - 1],
+                           split.path_nodes[move], split.path_edges[move - 1]);
+        worker.path_edges.push_back(split.path_edges[move - 1]);
+        worker.path_nodes.push_back(split.path_nodes[move]);
+    }
+}
+
+/****************************************************************************
+ * parallel_move_open
+ *
+ * - Lil helper function, checks whether a move can be played in the game
+ * being searched (MAC only needs an unused edge, AAC also needs an unused
+ * node on the other end)
+ ****************************************************************************/
+template <bool MAC>
+inline bool parallel_move_open(const PARALLEL_WORKER &__restrict worker,
+                               const uint_fast16_t neighbor,
+                               const uint32_t edge) {
+    return worker.edge_use_list.get(edge) == EDGE_STATE::NOT_USED &&
+           (MAC || worker.node_use_list.get(neighbor) == NODE_STATE::NOT_USED);
+}
+
+/****************************************************************************
+ * parallel_list_moves
+ *
+ * - Lists the moves worth trying from a worker's position on top of its move
+ * stack, in the worker's move order (see order_moves)
+ * - MAC moves onto poisoned nodes (see poisoned_node) are left out, since
+ * they lose for whoever makes them. So are moves back to a visited node, but
+ * the caller has to have checked for those already (they win right away)
+ *
+ * Parameters :
+ * - graph : the graph
+ * - worker : the worker, in the position to list the moves of
+ * - curr_node : the current node
+ *
+ * Returns :
+ * - uint32_t : the number of moves listed, from worker.move_top on
+ ****************************************************************************/
+template <bool MAC>
+uint32_t parallel_list_moves(const ADJACENCY_CSR &__restrict graph,
+                             PARALLEL_WORKER &__restrict worker,
+                             const uint_fast16_t curr_node) {
+    SEARCH_CONTEXT &context = worker.context;
+    uint32_t *const moves = &context.move_stack[worker.move_top];
+    uint32_t num_moves = 0;
+    if (context.move_order != MOVE_ORDER::LABEL) {
+        num_moves =
+            order_moves<MAC>(graph, worker.edge_use_list, worker.node_use_list,
+                             context, curr_node, moves);
+    } else {
+        for (uint32_t adj_index = graph.offsets[curr_node];
+             adj_index < graph.offsets[curr_node + 1]; adj_index++) {
+            if (parallel_move_open<MAC>(worker, graph.neighbors[adj_index],
+                                        graph.edge_ids[adj_index])) {
+                moves[num_moves++] = adj_index;
             }
         }
     }
 
-    // if we've gotten to this point there's no good moves-> game is in a loss
-    // state
-    return GAME_STATE::LOSS_STATE;
+    if constexpr (MAC) {
+        uint32_t kept = 0;
+        for (uint32_t index = 0; index < num_moves; index++) {
+            if (!poisoned_node(context, graph, worker.node_use_list,
+                               graph.neighbors[moves[index]], curr_node,
+                               true)) {
+                moves[kept++] = moves[index];
+            }
+        }
+        num_moves = kept;
+    }
+    return num_moves;
 }
 
 /****************************************************************************
- * play_MAC_threaded
+ * parallel_search_serial
  *
- * - Plays the MAC game on the specified graph by recursively attempting to
- * find a winning move from each player's "perspective" in turn
+ * - Searches a position deeper than the split plies, same as the quiet
+ * single threaded games but with periodic checks for cancellation
  *
  * Parameters :
- * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
- * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
+ * - search : the shared search state
+ * - worker : the worker doing the searching
+ * - split : the innermost split point enclosing the position
+ * - curr_node : the current node
  *
  * Returns :
- * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
+ * - GAME_STATE : WIN_STATE or LOSS_STATE, or KILL_STATE if the search was
+ * abandoned
  ****************************************************************************/
-GAME_STATE
-play_MAC_threaded(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-                  const std::vector<Adjacency_Info> &__restrict adj_matrix,
-                  std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-                  std::vector<NODE_STATE> &__restrict node_use_list) {
-    // TODO: replace open_edges with a bool? don't actually need the value, just
-    // whether its > 0
-    uint_fast16_t open_edges = 0; // stores the number of available edges we can
-                                  // move along from curr_node
-    GAME_STATE game_result = GAME_STATE::LOSS_STATE;
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
-            open_edges++;
-            if (node_use_list[curr_neighbor] ==
-                NODE_STATE::USED) { // if the neighbor has been previously
-                                    // visited, going back creates a cycle!
-                return GAME_STATE::WIN_STATE;
+template <bool MAC>
+GAME_STATE parallel_search_serial(PARALLEL_SEARCH &__restrict search,
+                                  PARALLEL_WORKER &__restrict worker,
+                                  const SPLIT_POINT *split,
+                                  const uint_fast16_t curr_node) {
+    if (parallel_tick(search, worker, split)) [[unlikely]] {
+        return GAME_STATE::KILL_STATE;
+    }
+    const ADJACENCY_CSR &graph = *search.graph;
+    // going back creates a cycle!
+    if (MAC && worker.context.cycle_edges[curr_node] > 0) {
+        return GAME_STATE::WIN_STATE;
+    }
+
+    const uint32_t move_begin = worker.move_top;
+    const uint32_t num_moves =
+        parallel_list_moves<MAC>(graph, worker, curr_node);
+    worker.move_top += num_moves;
+    GAME_STATE result = GAME_STATE::LOSS_STATE;
+    for (uint32_t index = 0; index < num_moves; index++) {
+        const uint32_t adj_index =
+            worker.context.move_stack[move_begin + index];
+        const uint_fast16_t curr_neighbor = graph.neighbors[adj_index];
+        const uint32_t curr_edge = graph.edge_ids[adj_index];
+        parallel_make_move(graph, worker, curr_node, curr_neighbor, curr_edge);
+        const GAME_STATE move_result = parallel_search_serial<MAC>(
+            search, worker, split, curr_neighbor);
+        parallel_take_back(graph, worker, curr_node, curr_neighbor, curr_edge);
+        if (move_result == GAME_STATE::LOSS_STATE) {
+            if (worker.context.move_order == MOVE_ORDER::HISTORY) {
+                note_winning_move(worker.context, adj_index);
             }
+            result = GAME_STATE::WIN_STATE;
+            break;
+        } else if (move_result == GAME_STATE::KILL_STATE) {
+            result = GAME_STATE::KILL_STATE;
+            break;
         }
     }
+    worker.move_top = move_begin;
 
-    if (open_edges == 0) { // if there are 0 open edges, we're in a loss state
-        return GAME_STATE::LOSS_STATE;
+    return result;
+}
+
+template <bool MAC>
+GAME_STATE parallel_search_node(PARALLEL_SEARCH &__restrict search,
+                                PARALLEL_WORKER &__restrict worker,
+                                const SPLIT_POINT *split,
+                                const uint_fast16_t curr_node);
+
+/****************************************************************************
+ * parallel_search_move
+ *
+ * - Plays a move on a worker's lists, searches the resulting position, and
+ * takes the move back
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - worker : the worker, in the position the move is played from
+ * - split : the innermost split point enclosing the resulting position
+ * - curr_node : the node moved from
+ * - adj_index : the move's CSR index
+ *
+ * Returns :
+ * - GAME_STATE : the result of the position after the move
+ ****************************************************************************/
+template <bool MAC>
+GAME_STATE parallel_search_move(PARALLEL_SEARCH &__restrict search,
+                                PARALLEL_WORKER &__restrict worker,
+                                const SPLIT_POINT *split,
+                                const uint_fast16_t curr_node,
+                                const uint32_t adj_index) {
+    const ADJACENCY_CSR &graph = *search.graph;
+    const uint_fast16_t neighbor = graph.neighbors[adj_index];
+    const uint32_t edge = graph.edge_ids[adj_index];
+    parallel_make_move(graph, worker, curr_node, neighbor, edge);
+    worker.path_nodes.push_back((uint16_t)neighbor);
+    worker.path_edges.push_back(edge);
+    const GAME_STATE move_result =
+        worker.path_edges.size() < search.split_plies
+            ? parallel_search_node<MAC>(search, worker, split, neighbor)
+            : parallel_search_serial<MAC>(search, worker, split, neighbor);
+    worker.path_edges.pop_back();
+    worker.path_nodes.pop_back();
+    parallel_take_back(graph, worker, curr_node, neighbor, edge);
+    if (move_result == GAME_STATE::LOSS_STATE &&
+        worker.context.move_order == MOVE_ORDER::HISTORY) {
+        note_winning_move(worker.context, adj_index);
     }
+    return move_result;
+}
+
+/****************************************************************************
+ * help_at_split
+ *
+ * - Searches moves at a split point until there aren't any left to take, or
+ * the split point is no longer worth searching
+ * - The caller must have already counted itself in the split point's helpers
+ * (or be its owner)
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - worker : the worker doing the searching
+ * - split : the split point
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+template <bool MAC>
+void help_at_split(PARALLEL_SEARCH &__restrict search,
+                   PARALLEL_WORKER &__restrict worker, SPLIT_POINT &split) {
+    sync_worker_state(*search.graph, worker, split);
+    const uint_fast16_t curr_node = split.path_nodes[split.depth];
 
-    ThreadPool pool(3);
-    std::stop_source token_source;
-    std::stop_token stoken = token_source.get_token();
-    std::vector<std::vector<EDGE_STATE>>
-        edge_states; // private copy of the edge state matrix for each job
-    std::vector<std::vector<NODE_STATE>>
-        node_states; // ^ same but for the node state list
-    std::vector<std::future<GAME_STATE>>
-        returns; // holds the returned future objects from the threaded calls
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            &&
-            edge_use_matrix[index_translation(num_nodes, curr_node,
-                                              curr_neighbor)] ==
-                EDGE_STATE::NOT_USED) { // and the edge between them is unused
-            edge_states.emplace_back(edge_use_matrix);
-            node_states.emplace_back(node_use_list);
-            MARK_EDGE(edge_states.back(), num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            returns.emplace_back(
-                pool.enqueue(play_MAC_recur, curr_neighbor, num_nodes,
-                             adj_matrix, std::ref(edge_states.back()),
-                             std::ref(node_states.back()), token_source));
+    while (!parallel_cancelled(search, &split)) {
+        const uint32_t move =
+            split.next_move.fetch_add(1, std::memory_order_relaxed);
+        if (move >= split.num_moves) {
+            break;
+        }
+        if (parallel_search_move<MAC>(search, worker, &split, curr_node,
+                                      split.moves[move]) ==
+            GAME_STATE::LOSS_STATE) {
+            split.won.store(true, std::memory_order_relaxed);
+            break;
         }
     }
+}
 
-    // now that we've queued up all the jobs, time to poll to see if there's any
-    // winners
-    bool keep_checking = true; // indicates whether we're still waiting on at
-                               // least one thread's return value
-    while (keep_checking) {
-        keep_checking = false;
-        for (std::future<GAME_STATE> &ret_val : returns) {
-            if (ret_val.valid()) {
-                keep_checking = true;
-                if (ret_val.wait_for(std::chrono::milliseconds(0)) ==
-                    std::future_status::ready) {
-                    if (ret_val.get() == GAME_STATE::WIN_STATE) {
-                        game_result = GAME_STATE::WIN_STATE;
-                        token_source.request_stop();
-                        keep_checking = false;
-                        break;
-                    }
+/****************************************************************************
+ * try_steal
+ *
+ * - Looks through the other workers' open split points (oldest first, since
+ * those have the most work underneath them) for a move to search, and
+ * searches moves there until that split point runs dry
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - worker : the worker looking for work
+ * - ancestor : if not NULL, only split points underneath this one are
+ * considered
+ *
+ * Returns :
+ * - bool : whether any work was found
+ ****************************************************************************/
+template <bool MAC>
+bool try_steal(PARALLEL_SEARCH &__restrict search,
+               PARALLEL_WORKER &__restrict worker,
+               const SPLIT_POINT *ancestor) {
+    const size_t num_workers = search.workers.size();
+    for (size_t offset = 1; offset < num_workers; offset++) {
+        PARALLEL_WORKER &victim =
+            *search.workers[(worker.index + offset) % num_workers];
+        SPLIT_POINT *target = NULL;
+        {
+            std::scoped_lock<std::mutex> lock(victim.split_mutex);
+            for (SPLIT_POINT *split : victim.split_points) {
+                if (split->next_move.load(std::memory_order_relaxed) >=
+                        split->num_moves ||
+                    parallel_cancelled(search, split)) {
+                    continue;
+                }
+                bool underneath = ancestor == NULL;
+                for (const SPLIT_POINT *above = split->parent;
+                     !underneath && above != NULL; above = above->parent) {
+                    underneath = above == ancestor;
+                }
+                if (underneath) {
+                    // counted while the lock is held, so the owner can't
+                    // retire the split point out from under us
+                    split->helpers.fetch_add(1, std::memory_order_acq_rel);
+                    target = split;
+                    break;
                 }
             }
         }
+        if (target != NULL) {
+            worker.steals++;
+            help_at_split<MAC>(search, worker, *target);
+            // the split point can be gone as soon as helpers hits 0, its owner
+            // isn't
+            PARALLEL_WORKER *owner = target->owner;
+            target->helpers.fetch_sub(1);
+            owner->wake.fetch_add(1);
+            owner->wake.notify_one();
+            return true;
+        }
     }
-
-    return game_result;
+    return false;
 }
 
-GAME_STATE
-play_AAC_recur(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-               const std::vector<Adjacency_Info> &__restrict adj_matrix,
-               std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-               std::vector<NODE_STATE> &__restrict node_use_list,
-               std::stop_source token_source) {
-    std::stop_token stoken = token_source.get_token();
-    if (stoken.stop_requested()) {
+/****************************************************************************
+ * parallel_search_node
+ *
+ * - Searches a position in the first split_plies moves of the game, turning
+ * it into a split point once its first move has been searched
+ *
+ * Parameters :
+ * - search : the shared search state
+ * - worker : the worker doing the searching, in the position to search
+ * - split : the innermost split point enclosing the position, or NULL
+ * - curr_node : the current node
+ *
+ * Returns :
+ * - GAME_STATE : WIN_STATE or LOSS_STATE, or KILL_STATE if the search was
+ * abandoned
+ ****************************************************************************/
+template <bool MAC>
+GAME_STATE parallel_search_node(PARALLEL_SEARCH &__restrict search,
+                                PARALLEL_WORKER &__restrict worker,
+                                const SPLIT_POINT *split,
+                                const uint_fast16_t curr_node) {
+    if (parallel_tick(search, worker, split)) [[unlikely]] {
         return GAME_STATE::KILL_STATE;
     }
+    const ADJACENCY_CSR &graph = *search.graph;
+    // going back creates a cycle!
+    if (MAC && worker.context.cycle_edges[curr_node] > 0) {
+        return GAME_STATE::WIN_STATE;
+    }
 
-    GAME_STATE
-        move_result; // temporarily store the result of a recursive call here
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            && edge_use_matrix[index_translation(num_nodes, curr_node,
-                                                 curr_neighbor)] ==
-                   EDGE_STATE::NOT_USED // and the edge between them is unused
-            && node_use_list[curr_neighbor] ==
-                   NODE_STATE::NOT_USED) { // move doesn't immediately result in
-                                           // a cycle, might as well try it out
-            // try making the move along that edge
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            move_result =
-                play_AAC_recur(curr_neighbor, num_nodes, adj_matrix,
-                               edge_use_matrix, node_use_list, token_source);
-            // reset the move after returning
-            MARK_EDGE(edge_use_matrix, num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::NOT_USED);
-            node_use_list[curr_neighbor] = NODE_STATE::NOT_USED;
-            if (move_result ==
-                GAME_STATE::LOSS_STATE) { // if the move puts the game into a
-                                          // loss state, then the current state
-                                          // is a win state
-                return GAME_STATE::WIN_STATE;
-            } else if (move_result == GAME_STATE::KILL_STATE) {
-                return GAME_STATE::KILL_STATE;
-            }
+    const uint32_t move_begin = worker.move_top;
+    const uint32_t num_moves =
+        parallel_list_moves<MAC>(graph, worker, curr_node);
+    const uint32_t *const moves = &worker.context.move_stack[move_begin];
+    if (num_moves == 0) {
+        return GAME_STATE::LOSS_STATE;
+    }
+    // the moves stay put on the stack until the split point's done with, so
+    // anything searched from here on (by this worker) goes on top of them
+    worker.move_top += num_moves;
+
+    // the eldest brother is searched on its own before anyone can help
+    const GAME_STATE eldest_result =
+        parallel_search_move<MAC>(search, worker, split, curr_node, moves[0]);
+    if (eldest_result == GAME_STATE::LOSS_STATE) {
+        worker.move_top = move_begin;
+        return GAME_STATE::WIN_STATE;
+    } else if (eldest_result == GAME_STATE::KILL_STATE) {
+        worker.move_top = move_begin;
+        return GAME_STATE::KILL_STATE;
+    } else if (num_moves == 1) { // no more moves to share
+        worker.move_top = move_begin;
+        return GAME_STATE::LOSS_STATE;
+    }
+
+    // open the rest of the moves up to the other workers
+    SPLIT_POINT here;
+    here.parent = split;
+    here.owner = &worker;
+    here.depth = (uint_fast16_t)worker.path_edges.size();
+    std::copy(worker.path_nodes.begin(), worker.path_nodes.end(),
+              here.path_nodes);
+    std::copy(worker.path_edges.begin(), worker.path_edges.end(),
+              here.path_edges);
+    here.moves = moves;
+    here.num_moves = num_moves;
+    here.next_move.store(1, std::memory_order_relaxed);
+    {
+        std::scoped_lock<std::mutex> lock(worker.split_mutex);
+        worker.split_points.push_back(&here);
+    }
+    worker.splits++;
+    search.work_epoch.fetch_add(1);
+    if (search.idle.load() > 0) {
+        { std::scoped_lock<std::mutex> lock(search.idle_mutex); }
+        search.idle_cv.notify_all();
+    }
+
+    help_at_split<MAC>(search, worker, here);
+
+    // nobody new can start helping once it's off the list, then wait for
+    // whoever's still at it (lending a hand underneath in the meantime)
+    {
+        std::scoped_lock<std::mutex> lock(worker.split_mutex);
+        worker.split_points.erase(std::find(worker.split_points.begin(),
+                                            worker.split_points.end(), &here));
+    }
+    while (true) {
+        // read before helpers, so a helper leaving after the check is sure
+        // to change it
+        const uint32_t seen_wake = worker.wake.load();
+        if (here.helpers.load() == 0) {
+            break;
+        }
+        if (!try_steal<MAC>(search, worker, &here)) {
+            worker.wake.wait(seen_wake);
         }
     }
+    sync_worker_state(graph, worker, here);
+    worker.move_top = move_begin;
 
-    // if we've gotten to this point there's no good moves-> game is in a loss
-    // state
-    return GAME_STATE::LOSS_STATE;
+    if (here.won.load(std::memory_order_relaxed)) {
+        return GAME_STATE::WIN_STATE;
+    }
+    return parallel_cancelled(search, split) ? GAME_STATE::KILL_STATE
+                                             : GAME_STATE::LOSS_STATE;
 }
 
 /****************************************************************************
- * play_AAC_threaded
+ * parallel_worker_loop
  *
- * - Plays the MAC game on the specified graph by recursively attempting to
- * find a winning move from each player's "perspective" in turn
+ * - What every worker other than the first one runs: steal work until the
+ * game's decided, sleeping whenever there's none to be had
  *
  * Parameters :
- * - curr node : the current node in the MAC game, as designated by the ordering
- * given in the graph's adjacency matrix
- * - num_nodes : the number of nodes in the graph
- * - adj_matrix : reference to a vector holding the adjency matrix for
- * the graph in question
- * - edge_use_matrix : reference to a vector keeping track of which edges
- * have been used so far in the game
- * - node_use_list : reference to a vector keeping track of which nodes have
- * been used so far in the game
+ * - search : the shared search state
+ * - worker_index : the worker's index in search.workers
+ * - stoken : stop is requested once the game's decided
  *
  * Returns :
- * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE
+ * - none
  ****************************************************************************/
-GAME_STATE
-play_AAC_threaded(const uint_fast16_t curr_node, const uint_fast16_t num_nodes,
-                  const std::vector<Adjacency_Info> &__restrict adj_matrix,
-                  std::vector<EDGE_STATE> &__restrict edge_use_matrix,
-                  std::vector<NODE_STATE> &__restrict node_use_list) {
-    GAME_STATE game_result = GAME_STATE::LOSS_STATE;
-
-    ThreadPool pool(3);
-    std::stop_source token_source;
-    std::stop_token stoken = token_source.get_token();
-    std::vector<std::vector<EDGE_STATE>>
-        edge_states; // private copy of the edge state matrix for each job
-    std::vector<std::vector<NODE_STATE>>
-        node_states; // ^ same but for the node state list
-    std::vector<std::future<GAME_STATE>>
-        returns; // holds the returned future objects from the threaded calls
-
-    for (uint_fast16_t curr_neighbor = 0; curr_neighbor < num_nodes;
-         curr_neighbor++) {
-        if (adj_matrix[index_translation(num_nodes, curr_node,
-                                         curr_neighbor)] ==
-                Adjacency_Info::ADJACENT // if curr_node and curr_neighbor are
-                                         // adjacent
-            && edge_use_matrix[index_translation(num_nodes, curr_node,
-                                                 curr_neighbor)] ==
-                   EDGE_STATE::NOT_USED // and the edge between them is unused
-            && node_use_list[curr_neighbor] ==
-                   NODE_STATE::NOT_USED) { // move doesn't immediately result in
-                                           // a cycle, might as well try it out
-            // try making the move along that edge
-            edge_states.emplace_back(edge_use_matrix);
-            node_states.emplace_back(node_use_list);
-            MARK_EDGE(edge_states.back(), num_nodes, curr_neighbor, curr_node,
-                      EDGE_STATE::USED);
-            node_use_list[curr_neighbor] = NODE_STATE::USED;
-            returns.emplace_back(
-                pool.enqueue(play_AAC_recur, curr_neighbor, num_nodes,
-                             adj_matrix, std::ref(edge_states.back()),
-                             std::ref(node_states.back()), token_source));
+template <bool MAC>
+void parallel_worker_loop(PARALLEL_SEARCH &__restrict search,
+                          const size_t worker_index,
+                          const std::stop_token stoken) {
+    PARALLEL_WORKER &worker = *search.workers[worker_index];
+    std::stop_callback wake_up(stoken, [&search]() {
+        { std::scoped_lock<std::mutex> lock(search.idle_mutex); }
+        search.idle_cv.notify_all();
+    });
+    while (!stoken.stop_requested()) {
+        // announce we're idle before looking, so that a split point opened
+        // after the look is sure to wake us back up
+        search.idle.fetch_add(1);
+        const uint64_t seen_epoch = search.work_epoch.load();
+        if (!try_steal<MAC>(search, worker, NULL)) {
+            std::unique_lock<std::mutex> lock(search.idle_mutex);
+            search.idle_cv.wait(lock, [&search, seen_epoch, &stoken] {
+                return search.work_epoch.load() != seen_epoch ||
+                       stoken.stop_requested();
+            });
         }
+        search.idle.fetch_sub(1);
     }
+}
 
-    // now that we've queued up all the jobs, time to poll to see if there's any
-    // winners
-    bool keep_checking = true; // indicates whether we're still waiting on at
-                               // least one thread's return value
-    while (keep_checking) {
-        keep_checking = false;
-        for (std::future<GAME_STATE> &ret_val : returns) {
-            if (ret_val.valid()) {
-                keep_checking = true;
-                if (ret_val.wait_for(std::chrono::milliseconds(0)) ==
-                    std::future_status::ready) {
-                    if (ret_val.get() == GAME_STATE::WIN_STATE) {
-                        game_result = GAME_STATE::WIN_STATE;
-                        token_source.request_stop();
-                        keep_checking = false;
-                        break;
-                    }
-                }
-            }
+/****************************************************************************
+ * play_threaded
+ *
+ * - Plays a game on the specified graph with several threads (see the top of
+ * this file)
+ * - One worker runs on each of the pool's threads, and the calling thread
+ * blocks until the game's decided
+ *
+ * Parameters :
+ * - start_node : the node the game starts on
+ * - graph : reference to the CSR form of the graph in question
+ * - pool : the threads to search with, shouldn't be busy with anything else
+ * - move_order : the order every worker tries moves in (see order_moves)
+ * - deadline : when to give up on the game, or NULL for no limit
+ * - stats_out : where to write the search's counters, can be NULL
+ *
+ * Returns :
+ * - GAME_STATE : indication of whether the game is in a WIN_STATE or LOSS_STATE,
+ * or KILL_STATE if the game ran past its deadline
+ ****************************************************************************/
+template <bool MAC>
+GAME_STATE
+play_threaded(const uint_fast16_t start_node,
+              const ADJACENCY_CSR &__restrict graph, ThreadPool &pool,
+              const MOVE_ORDER move_order,
+              const std::chrono::steady_clock::time_point *deadline,
+              PARALLEL_STATS *stats_out) {
+    const size_t num_threads = pool.getThreadCount();
+    PARALLEL_SEARCH search;
+    search.graph = &graph;
+    search.has_deadline = deadline != NULL;
+    if (deadline != NULL) {
+        search.deadline = *deadline;
+    }
+    for (size_t index = 0; index < num_threads; index++) {
+        auto worker = std::make_unique<PARALLEL_WORKER>();
+        worker->index = index;
+        worker->edge_use_list = PACKED_STATES<EDGE_STATE>(graph.num_edges);
+        worker->node_use_list = PACKED_STATES<NODE_STATE>(graph.num_nodes);
+        worker->node_use_list.set(start_node, NODE_STATE::USED);
+        worker->path_nodes.reserve(PARALLEL_SPLIT_PLIES + 1);
+        worker->path_edges.reserve(PARALLEL_SPLIT_PLIES);
+        worker->path_nodes.push_back((uint16_t)start_node);
+        // a line of play never lists a node's moves twice, so the rows' total
+        // length is enough for the whole move stack (work stolen while a
+        // worker waits on a split point is always further down the same line)
+        const size_t num_adj = graph.offsets[graph.num_nodes];
+        set_move_order(&worker->context, move_order, graph.num_nodes);
+        worker->context.move_stack.resize(num_adj);
+        worker->context.move_scores.resize(num_adj);
+        worker->context.history.assign(num_adj, 0);
+        worker->context.killers.assign((size_t)graph.num_nodes + 1,
+                                       UINT32_MAX);
+        count_node_edges(worker->context, graph, worker->edge_use_list,
+                         worker->node_use_list);
+        search.workers.push_back(std::move(worker));
+    }
+
+    // worker 0 plays from the start, and is the only one with a result. As
+    // soon as it's back the rest are told to stop
+    std::vector<std::function<std::optional<GAME_STATE>(std::stop_token)>>
+        jobs;
+    jobs.push_back([&search, start_node](std::stop_token) {
+        return std::optional<GAME_STATE>(parallel_search_node<MAC>(
+            search, *search.workers[0], NULL, start_node));
+    });
+    for (size_t index = 1; index < num_threads; index++) {
+        jobs.push_back([&search, index](std::stop_token stoken) {
+            parallel_worker_loop<MAC>(search, index, stoken);
+            return std::optional<GAME_STATE>();
+        });
+    }
+    const std::optional<std::optional<GAME_STATE>> winner =
+        pool.when_any<std::optional<GAME_STATE>>(
+            std::move(jobs), [](const std::optional<GAME_STATE> &result) {
+                return result.has_value();
+            });
+    const GAME_STATE result = **winner;
+
+    if (stats_out != NULL) {
+        *stats_out = PARALLEL_STATS{};
+        stats_out->threads = num_threads;
+        for (const auto &worker : search.workers) {
+            stats_out->nodes += worker->nodes;
+            stats_out->splits += worker->splits;
+            stats_out->steals += worker->steals;
         }
     }
+    return result;
+}
 
-    return game_result;
+/****************************************************************************
+ * play_MAC_threaded/ play_AAC_threaded
+ *
+ * - Plays the MAC/ AAC game on the specified graph with several threads, see
+ * play_threaded for the parameters
+ ****************************************************************************/
+GAME_STATE
+play_MAC_threaded(const uint_fast16_t start_node,
+                  const ADJACENCY_CSR &__restrict graph, ThreadPool &pool,
+                  const MOVE_ORDER move_order,
+                  const std::chrono::steady_clock::time_point *deadline,
+                  PARALLEL_STATS *stats_out) {
+    return play_threaded<true>(start_node, graph, pool, move_order, deadline,
+                              stats_out);
+}
+
+GAME_STATE
+play_AAC_threaded(const uint_fast16_t start_node,
+                  const ADJACENCY_CSR &__restrict graph, ThreadPool &pool,
+                  const MOVE_ORDER move_order,
+                  const std::chrono::steady_clock::time_point *deadline,
+                  PARALLEL_STATS *stats_out) {
+    return play_threaded<false>(start_node, graph, pool, move_order, deadline,
+                              stats_out);
 }
@@ -0,0 +1,462 @@
+#pragma once
+/*
+ *
+ * - This file holds the binary graph file format: a graph already in CSR form
+ * (see ADJACENCY_CSR), written out so a run can map the file into memory and
+ * play on it as is, without reading through a text listing
+ * - The text listings stay the format the graphs are shared in. A graph file
+ * gets made from one with convert_adjacency_file, or straight from a
+ * generator with write_graph_file
+ * - load_graph takes either kind of file, going by the extension
+ *
+ * File layout (native byte order, checked against byte_order on load):
+ *	GRAPH_FILE_HEADER, then the CSR arrays one after the other:
+ *	offsets (num_nodes + 1 uint32_t's), edge_ids (num_adj uint32_t's),
+ *	neighbors (num_adj uint16_t's, or uint32_t's for graphs with more than
+ *	ADJ_NARROW_MAX_NODES nodes). checksum covers everything after the header
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Misc.h"
+
+// First 8 bytes of a graph file, followed by the format's version
+#define GRAPH_FILE_MAGIC "CYCGRAPH"
+#define GRAPH_FILE_VERSION 1
+#define GRAPH_FILE_EXT ".csr"
+#define GRAPH_FILE_BYTE_ORDER 0x01020304U
+#define GRAPH_FILE_MAX_PARAMS 4
+
+// The graph family a file was generated from, if it's known
+enum class GRAPH_FAMILY : uint32_t {
+    UNKNOWN,
+    GENERALIZED_PETERSEN, // parameters n, k
+    STACKED_PRISM,        // parameters m, n
+    Z_MN,                 // parameters m, n
+    NUM_FAMILIES
+};
+// Names the families go by in file names, spaces or underscores both work
+inline constexpr const char *GRAPH_FAMILY_NAMES[] = {
+    "", "Generalized Petersen", "Stacked Prism", "Z_m^n"};
+
+typedef struct GRAPH_FILE_HEADER {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; // GRAPH_FILE_BYTE_ORDER, as the writer saw it
+    uint32_t num_nodes;
+    uint32_t num_edges;
+    uint64_t num_adj; // entries in edge_ids/ neighbors
+    uint32_t family;  // GRAPH_FAMILY
+    uint32_t num_params;
+    uint32_t params[GRAPH_FILE_MAX_PARAMS];
+    uint64_t checksum; // graph_file_checksum of the arrays
+} GRAPH_FILE_HEADER;
+static_assert(sizeof(GRAPH_FILE_HEADER) == 64,
+              "The graph file header's layout shouldn't have any padding");
+
+/****************************************************************************
+ * graph_file_checksum
+ *
+ * - Hashes a block of memory 8 bytes at a time, for the graph file's checksum
+ * - It's only there to catch truncated/ corrupted files, so it just has to be
+ * quick to work out over the whole file when it's loaded
+ *
+ * Parameters :
+ * - data : the block to hash
+ * - size : its length in bytes
+ *
+ * Returns :
+ * - uint64_t : the hash
+ ****************************************************************************/
+uint64_t graph_file_checksum(const char *__restrict data, const size_t size) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + pos, sizeof(word));
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + pos, size - pos);
+    hash = (hash ^ tail) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 29);
+}
+
+/****************************************************************************
+ * write_graph_file
+ *
+ * - Writes a graph in CSR form out to a graph file, with node labels of the
+ * same width the graph has
+ *
+ * Parameters :
+ * - path : the file to write
+ * - graph : the graph
+ * - family : the family the graph's from, if it's known
+ * - params : the family's parameters (at most GRAPH_FILE_MAX_PARAMS)
+ *
+ * Returns :
+ * - bool : false if the file couldn't be written
+ ****************************************************************************/
+template <typename NODE_T>
+bool write_graph_file(const std::filesystem::path &__restrict path,
+                      const ADJACENCY_CSR_T<NODE_T> &__restrict graph,
+                      const GRAPH_FAMILY family,
+                      const std::vector<uint32_t> &__restrict params) {
+    if (params.size() > GRAPH_FILE_MAX_PARAMS) [[unlikely]] {
+        DISPLAY_ERR(false, "Too many graph parameters for a graph file.");
+        return false;
+    }
+    const size_t num_adj = graph.offsets[graph.num_nodes];
+    const size_t offsets_size =
+        ((size_t)graph.num_nodes + 1) * sizeof(uint32_t);
+    const size_t edge_ids_size = num_adj * sizeof(uint32_t);
+    const size_t neighbors_size = num_adj * sizeof(NODE_T);
+
+    // the arrays get laid out in a single block, so the checksum can go over
+    // them the same way it will when the file is loaded
+    std::vector<char> body(offsets_size + edge_ids_size + neighbors_size);
+    std::memcpy(body.data(), graph.offsets, offsets_size);
+    std::memcpy(body.data() + offsets_size, graph.edge_ids, edge_ids_size);
+    std::memcpy(body.data() + offsets_size + edge_ids_size, graph.neighbors,
+                neighbors_size);
+
+    GRAPH_FILE_HEADER header = {};
+    std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.byte_order = GRAPH_FILE_BYTE_ORDER;
+    header.num_nodes = (uint32_t)graph.num_nodes;
+    header.num_edges = (uint32_t)graph.num_edges;
+    header.num_adj = num_adj;
+    header.family = (uint32_t)family;
+    header.num_params = (uint32_t)params.size();
+    std::copy(params.begin(), params.end(), header.params);
+    header.checksum = graph_file_checksum(body.data(), body.size());
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output.write((const char *)&header, sizeof(header));
+    output.write(body.data(), (std::streamsize)body.size());
+    if (!output) [[unlikely]] {
+        DISPLAY_ERR(false,
+                    "Failed to write the graph file.\nRequested path: %s",
+                    path.string().c_str());
+        return false;
+    }
+    return true;
+}
+
+/****************************************************************************
+ * write_graph_file
+ *
+ * - Builds a graph from a generator's entries (see ADJ_LIST_OUT), then writes
+ * it out to a graph file
+ *
+ * Parameters :
+ * - path : the file to write
+ * - entries : the generator's entries. The contents are reordered by the call
+ * - family : the family the graph's from
+ * - params : the family's parameters (at most GRAPH_FILE_MAX_PARAMS)
+ *
+ * Returns :
+ * - bool : false if the file couldn't be written
+ ****************************************************************************/
+bool write_graph_file(const std::filesystem::path &__restrict path,
+                      std::vector<ADJ_LIST_ENTRY> &entries,
+                      const GRAPH_FAMILY family,
+                      const std::vector<uint32_t> &__restrict params) {
+    uint_fast32_t max_label = 0;
+    for (const ADJ_LIST_ENTRY &entry : entries) {
+        max_label = std::max<uint_fast32_t>(
+            max_label, std::max(entry.first, entry.second));
+    }
+    const ANY_ADJACENCY_CSR graph = build_any_adjacency_csr(
+        entries, entries.empty() ? 0 : max_label + 1);
+    return std::visit(
+        [&](const auto &csr) {
+            return write_graph_file(path, csr, family, params);
+        },
+        graph);
+}
+
+/****************************************************************************
+ * point_at_graph_file
+ *
+ * - Lil helper function, points a graph's arrays at a mapped graph file whose
+ * header has already been checked
+ *
+ * Parameters :
+ * - header : the file's header
+ * - file : the mapped file, kept alive by the graph from then on
+ *
+ * Returns :
+ * - ADJACENCY_CSR_T<NODE_T> : the graph
+ ****************************************************************************/
+template <typename NODE_T>
+ADJACENCY_CSR_T<NODE_T>
+point_at_graph_file(const GRAPH_FILE_HEADER &__restrict header,
+                    std::shared_ptr<MAPPED_FILE> file) {
+    const char *const body = file->data + sizeof(header);
+    ADJACENCY_CSR_T<NODE_T> graph;
+    graph.num_nodes = header.num_nodes;
+    graph.num_edges = header.num_edges;
+    graph.offsets = (const uint32_t *)body;
+    graph.edge_ids =
+        (const uint32_t *)(body +
+                           ((size_t)header.num_nodes + 1) * sizeof(uint32_t));
+    graph.neighbors = (const NODE_T *)(graph.edge_ids + header.num_adj);
+    graph.storage = std::move(file);
+    return graph;
+}
+
+/****************************************************************************
+ * graph_file_rows_valid
+ *
+ * - Checks that a graph file's arrays make a CSR graph the games can safely
+ * walk: the row offsets start at 0, never go down and end at num_adj, and
+ * every neighbor and edge ID is in range
+ * - The checksum only catches accidents, a file that's been edited (and had
+ * its checksum fixed up) could otherwise send the games off the ends of the
+ * arrays
+ *
+ * Parameters :
+ * - header : the file's header, already checked against the file's size
+ * - body : the arrays, just past the header
+ *
+ * Returns :
+ * - bool : true if the arrays hold together
+ ****************************************************************************/
+template <typename NODE_T>
+bool graph_file_rows_valid(const GRAPH_FILE_HEADER &__restrict header,
+                           const char *__restrict body) {
+    const uint32_t *const offsets = (const uint32_t *)body;
+    const uint32_t *const edge_ids = offsets + (size_t)header.num_nodes + 1;
+    const NODE_T *const neighbors = (const NODE_T *)(edge_ids + header.num_adj);
+
+    if (offsets[0] != 0 || offsets[header.num_nodes] != header.num_adj) {
+        return false;
+    }
+    for (size_t node = 0; node < header.num_nodes; node++) {
+        if (offsets[node] > offsets[node + 1]) {
+            return false;
+        }
+    }
+    for (size_t index = 0; index < header.num_adj; index++) {
+        if (neighbors[index] >= header.num_nodes ||
+            edge_ids[index] >= header.num_edges) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/****************************************************************************
+ * map_graph_file
+ *
+ * - Maps a graph file into memory (see map_file), and points the graph's
+ * arrays straight at it
+ * - Beyond checking the header, the checksum and that the rows hold together
+ * (see graph_file_rows_valid), there's nothing to do, the file already holds
+ * the arrays the way the games use them
+ * - The width of the graph's node labels goes by its number of nodes, same as
+ * it does when a text listing is loaded
+ *
+ * Parameters :
+ * - path : the graph file
+ * - success_out : pointer to a bool indicating whether the graph was
+ * successfully loaded to the caller
+ *
+ * Returns :
+ * - ANY_ADJACENCY_CSR : the loaded graph
+ ****************************************************************************/
+ANY_ADJACENCY_CSR map_graph_file(const std::filesystem::path &__restrict path,
+                                 bool *__restrict success_out) {
+    *success_out = false;
+    ANY_ADJACENCY_CSR graph;
+    auto file = std::make_shared<MAPPED_FILE>();
+    if (!map_file(path, file.get())) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "Failed to open the graph file, or it's empty.\nRequested "
+                    "path: %s",
+                    path.string().c_str());
+        return graph;
+    }
+    const char *const data = file->data;
+    const size_t size = file->size;
+
+    GRAPH_FILE_HEADER header = {};
+    if (size >= sizeof(header)) [[likely]] {
+        std::memcpy(&header, data, sizeof(header));
+    }
+    if (std::memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic)) !=
+            0 ||
+        header.byte_order != GRAPH_FILE_BYTE_ORDER) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "Not a graph file, or one written on a machine with a "
+                    "different byte order.\nFile path: %s",
+                    path.string().c_str());
+        return graph;
+    }
+    if (header.version != GRAPH_FILE_VERSION) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "Graph file version %u isn't supported (expected %u). "
+                    "Convert the text listing again.\nFile path: %s",
+                    header.version, GRAPH_FILE_VERSION, path.string().c_str());
+        return graph;
+    }
+    const size_t body_size = size - sizeof(header);
+    const size_t offsets_size =
+        ((size_t)header.num_nodes + 1) * sizeof(uint32_t);
+    const bool wide = header.num_nodes > ADJ_NARROW_MAX_NODES;
+    const size_t label_size = wide ? sizeof(uint32_t) : sizeof(uint16_t);
+    if (header.num_nodes == 0 || header.num_adj > body_size ||
+        offsets_size + header.num_adj * (sizeof(uint32_t) + label_size) !=
+            body_size ||
+        graph_file_checksum(data + sizeof(header), body_size) !=
+            header.checksum) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "The graph file is truncated or corrupted.\nFile path: %s",
+                    path.string().c_str());
+        return graph;
+    }
+
+    if (header.num_edges > ADJ_MAX_EDGES ||
+        !(wide ? graph_file_rows_valid<uint32_t>(header, data + sizeof(header))
+               : graph_file_rows_valid<uint16_t>(header,
+                                                 data + sizeof(header))))
+        [[unlikely]] {
+        DISPLAY_ERR(true, "The graph file's rows don't add up.\nFile path: %s",
+                    path.string().c_str());
+        return graph;
+    }
+
+    if (wide) {
+        graph = point_at_graph_file<uint32_t>(header, std::move(file));
+    } else {
+        graph = point_at_graph_file<uint16_t>(header, std::move(file));
+    }
+    *success_out = true;
+    return graph;
+}
+
+/****************************************************************************
+ * load_graph
+ *
+ * - Loads a graph from either a graph file (GRAPH_FILE_EXT) or a text
+ * adjacency listing (anything else, see load_adjacency_info)
+ *
+ * Parameters :
+ * - file_path : path to the file
+ * - success_out : pointer to a bool indicating whether the graph was
+ * successfully loaded to the caller
+ *
+ * Returns :
+ * - ANY_ADJACENCY_CSR : the loaded graph
+ ****************************************************************************/
+ANY_ADJACENCY_CSR load_graph(const std::filesystem::path &__restrict file_path,
+                             bool *__restrict success_out) {
+    if (file_path.extension() == GRAPH_FILE_EXT) {
+        return map_graph_file(file_path, success_out);
+    }
+    return load_adjacency_info(file_path, success_out);
+}
+
+/****************************************************************************
+ * guess_graph_family
+ *
+ * - Works out the family and parameters of a graph from its file name, for
+ * names of the form "<Graph Family Name> (param1, param2, ...)", with spaces
+ * or underscores
+ *
+ * Parameters :
+ * - file_path : path to the graph's file
+ * - params_out : where the parameters go, if the family's known
+ *
+ * Returns :
+ * - GRAPH_FAMILY : the family, or UNKNOWN if the name doesn't say
+ ****************************************************************************/
+GRAPH_FAMILY guess_graph_family(const std::filesystem::path &__restrict
+                                    file_path,
+                                std::vector<uint32_t> *__restrict params_out) {
+    params_out->clear();
+    std::string name = file_path.stem().string();
+    std::replace(name.begin(), name.end(), '_', ' ');
+    for (uint32_t family = 1; family < (uint32_t)GRAPH_FAMILY::NUM_FAMILIES;
+         family++) {
+        std::string family_name = GRAPH_FAMILY_NAMES[family];
+        std::replace(family_name.begin(), family_name.end(), '_', ' ');
+        if (name.rfind(family_name + " (", 0) != 0) {
+            continue;
+        }
+        uint32_t value = 0;
+        bool in_number = false;
+        for (size_t pos = family_name.size() + 2; pos < name.size(); pos++) {
+            const char c = name[pos];
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (uint32_t)(c - '0');
+                in_number = true;
+            } else if (c == ',' || c == ')') {
+                if (!in_number || params_out->size() == GRAPH_FILE_MAX_PARAMS) {
+                    break;
+                }
+                params_out->push_back(value);
+                value = 0;
+                in_number = false;
+                if (c == ')') {
+                    return (GRAPH_FAMILY)family;
+                }
+            } else if (c != ' ') {
+                break;
+            }
+        }
+        params_out->clear();
+    }
+    return GRAPH_FAMILY::UNKNOWN;
+}
+
+/****************************************************************************
+ * convert_adjacency_file
+ *
+ * - Reads a text adjacency listing in and writes it back out as a graph file,
+ * next to it with the extension swapped for GRAPH_FILE_EXT unless somewhere
+ * else is asked for
+ * - The graph's family and parameters come from the file's name, if it has
+ * one of the usual ones
+ *
+ * Parameters :
+ * - text_path : the text adjacency listing
+ * - graph_path_out : where the graph file goes. If it's empty, it gets set to
+ * where the file was written
+ *
+ * Returns :
+ * - bool : false if the listing couldn't be read or the file written
+ ****************************************************************************/
+bool convert_adjacency_file(const std::filesystem::path &__restrict text_path,
+                            std::filesystem::path *__restrict graph_path_out) {
+    bool load_success = false;
+    const ANY_ADJACENCY_CSR graph =
+        load_adjacency_info(text_path, &load_success);
+    if (!load_success) [[unlikely]] {
+        return false;
+    }
+    if (graph_path_out->empty()) {
+        *graph_path_out = text_path;
+        graph_path_out->replace_extension(GRAPH_FILE_EXT);
+    }
+    std::vector<uint32_t> params;
+    const GRAPH_FAMILY family = guess_graph_family(text_path, &params);
+    return std::visit(
+        [&](const auto &csr) {
+            return write_graph_file(*graph_path_out, csr, family, params);
+        },
+        graph);
+}
@@ -0,0 +1,398 @@
+#pragma once
+/*
+ *
+ * - This file holds a maximum matching finder (Edmonds' blossom algorithm)
+ * along with the Gallai-Edmonds pieces needed to solve AAC without searching
+ * - Everything here works on graphs with either width of node labels (see
+ * ADJACENCY_CSR_T), since it runs in polynomial time and so is still of use on
+ * graphs far too big to search
+ * - AAC only ever moves to unvisited nodes (moving to a visited one closes a
+ * cycle and loses), so it's the game undirected vertex geography. That game
+ * is solved: the player moving from the start node wins exactly when the start
+ * node is covered by every maximum matching of the graph (Fraenkel, Scheinerman
+ * and Ullman, 1993)
+ * - The nodes missed by at least one maximum matching ("inessential" nodes)
+ * are exactly the ones an alternating path of even length reaches from a node
+ * left uncovered by a maximum matching. One more search of the same kind the
+ * matching is grown with finds all of them at once
+ * - Self loops are skipped wherever a node's row is walked: a node can't be
+ * matched to itself, and AAC can never move along a loop anyway
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+
+// Stand in for "no node" in the matching arrays
+#define MATCH_NONE UINT32_MAX
+
+// Scratch space for growing alternating trees (see grow_alternating_forest)
+typedef struct MATCHING_SEARCH {
+    std::vector<uint32_t> mate;    // node matched to each node, or MATCH_NONE
+    std::vector<uint32_t> parent;  // odd nodes: the even node they came from
+    // each shrunken blossom's nodes are grouped together with union-find
+    // links, and the blossom's base is kept at the group's root
+    std::vector<uint32_t> blossom;
+    std::vector<uint32_t> base;
+    std::vector<bool> even;        // reached by an even length path
+    std::vector<uint32_t> queue;   // even nodes waiting to be scanned
+    std::vector<uint32_t> reached; // every node the forest has touched
+    std::vector<uint32_t> merging; // nodes of a blossom being shrunk
+    std::vector<bool> removed;     // left out of the search entirely
+    // by base, for lowest_common_base. A base is marked when its entry equals
+    // mark_stamp, so clearing them is just a bump
+    std::vector<uint32_t> mark;
+    uint32_t mark_stamp = 0;
+} MATCHING_SEARCH;
+
+/****************************************************************************
+ * clear_marks
+ *
+ * - Lil helper function, unmarks every base at once
+ *
+ * Parameters :
+ * - search : the search in progress
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+inline void clear_marks(MATCHING_SEARCH &__restrict search) {
+    if (++search.mark_stamp == 0) [[unlikely]] { // wrapped around
+        std::fill(search.mark.begin(), search.mark.end(), 0);
+        search.mark_stamp = 1;
+    }
+}
+
+/****************************************************************************
+ * blossom_root
+ *
+ * - Lil helper function, finds the union-find root of the blossom a node is
+ * in, halving the path there along the way
+ *
+ * Parameters :
+ * - search : the search in progress
+ * - node : the node in question
+ *
+ * Returns :
+ * - uint32_t : the root
+ ****************************************************************************/
+inline uint32_t blossom_root(MATCHING_SEARCH &__restrict search,
+                             uint32_t node) {
+    while (search.blossom[node] != node) {
+        search.blossom[node] = search.blossom[search.blossom[node]];
+        node = search.blossom[node];
+    }
+    return node;
+}
+
+/****************************************************************************
+ * blossom_base
+ *
+ * - Lil helper function, finds the base of the (outermost) blossom a node is
+ * in. Nodes outside of any blossom are their own base
+ *
+ * Parameters :
+ * - search : the search in progress
+ * - node : the node in question
+ *
+ * Returns :
+ * - uint32_t : the base
+ ****************************************************************************/
+inline uint32_t blossom_base(MATCHING_SEARCH &__restrict search,
+                             const uint32_t node) {
+    return search.base[blossom_root(search, node)];
+}
+
+/****************************************************************************
+ * lowest_common_base
+ *
+ * - Lil helper function, finds the base of the blossom two even nodes of the
+ * same alternating tree close, by walking up from both towards the root
+ *
+ * Parameters :
+ * - search : the search in progress
+ * - node_1, node_2 : two adjacent even nodes
+ *
+ * Returns :
+ * - uint32_t : the base of the blossom, or MATCH_NONE if the nodes are in
+ * different trees (which means there's an augmenting path between the roots)
+ ****************************************************************************/
+uint32_t lowest_common_base(MATCHING_SEARCH &__restrict search,
+                            uint32_t node_1, uint32_t node_2) {
+    clear_marks(search);
+    while (true) {
+        node_1 = blossom_base(search, node_1);
+        search.mark[node_1] = search.mark_stamp;
+        if (search.mate[node_1] == MATCH_NONE) { // root
+            break;
+        }
+        node_1 = search.parent[search.mate[node_1]];
+    }
+    while (true) {
+        node_2 = blossom_base(search, node_2);
+        if (search.mark[node_2] == search.mark_stamp) {
+            return node_2;
+        }
+        if (search.mate[node_2] == MATCH_NONE) { // some other root
+            return MATCH_NONE;
+        }
+        node_2 = search.parent[search.mate[node_2]];
+    }
+}
+
+/****************************************************************************
+ * shrink_blossom_path
+ *
+ * - Lil helper function, walks the tree path from an even node up to a new
+ * blossom's base: the odd nodes on it become even, the even nodes are pointed
+ * back across the edge that closed the blossom (so that paths through it can
+ * still be traced node by node later on), and the nodes are queued up in
+ * merging to be grouped into the new blossom. The grouping has to wait until
+ * both sides are walked, the walks step through the old blossoms node by node
+ *
+ * Parameters :
+ * - search : the search in progress
+ * - node : the even node to start from
+ * - new_base : the base of the new blossom
+ * - child : the even node across the edge that closed the blossom
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void shrink_blossom_path(MATCHING_SEARCH &__restrict search, uint32_t node,
+                         const uint32_t new_base, uint32_t child) {
+    while (blossom_base(search, node) != new_base) {
+        const uint32_t mate = search.mate[node];
+        search.merging.push_back(node);
+        search.merging.push_back(mate);
+        // the odd nodes are the only ones inside the new blossom that weren't
+        // even already
+        if (!search.even[mate]) {
+            search.even[mate] = true;
+            search.queue.push_back(mate);
+        }
+        search.parent[node] = child;
+        child = mate;
+        node = search.parent[mate];
+    }
+}
+
+/****************************************************************************
+ * grow_alternating_forest
+ *
+ * - Grows alternating trees from the given roots (nodes the matching leaves
+ * uncovered) breadth first, shrinking blossoms as they turn up
+ * - With a single root, stops at the first uncovered node the tree reaches
+ * (the end of an augmenting path). With several roots, the matching is assumed
+ * to be maximum already, and the whole forest is grown
+ *
+ * Parameters :
+ * - graph : the graph
+ * - search : the search state. Its mate array is the current matching, and the
+ * rest is reset here
+ * - roots : the nodes to grow trees from
+ *
+ * Returns :
+ * - uint32_t : the uncovered node an augmenting path was found to (its path
+ * back to the root can be followed with parent and mate), or MATCH_NONE
+ ****************************************************************************/
+template <typename NODE_T>
+uint32_t
+grow_alternating_forest(const ADJACENCY_CSR_T<NODE_T> &__restrict graph,
+                        MATCHING_SEARCH &__restrict search,
+                        const std::vector<uint32_t> &__restrict roots) {
+    // only what the last forest touched needs resetting, which keeps
+    // augmenting along a short path cheap on a big graph
+    for (const uint32_t node : search.reached) {
+        search.parent[node] = MATCH_NONE;
+        search.even[node] = false;
+        search.blossom[node] = node;
+        search.base[node] = node;
+    }
+    search.reached.clear();
+    search.queue.clear();
+    for (const uint32_t root : roots) {
+        search.even[root] = true;
+        search.queue.push_back(root);
+        search.reached.push_back(root);
+    }
+
+    for (size_t head = 0; head < search.queue.size(); head++) {
+        const uint32_t node = search.queue[head];
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            const uint32_t neighbor = graph.neighbors[adj_index];
+            if (neighbor == node || search.removed[neighbor]) {
+                continue;
+            }
+            if (blossom_base(search, node) == blossom_base(search, neighbor) ||
+                search.mate[node] == neighbor) {
+                continue; // inside one blossom, or the matched edge itself
+            }
+
+            if (search.even[neighbor]) {
+                // two even nodes meet: shrink the blossom they close
+                const uint32_t new_base =
+                    lowest_common_base(search, node, neighbor);
+                if (new_base == MATCH_NONE) [[unlikely]] {
+                    // trees of two different roots meeting would be an
+                    // augmenting path, which a maximum matching can't have
+                    assert(false);
+                    continue;
+                }
+                search.merging.clear();
+                shrink_blossom_path(search, node, new_base, neighbor);
+                shrink_blossom_path(search, neighbor, new_base, node);
+                const uint32_t new_root = blossom_root(search, new_base);
+                for (const uint32_t member : search.merging) {
+                    search.blossom[blossom_root(search, member)] = new_root;
+                }
+            } else if (search.parent[neighbor] == MATCH_NONE) {
+                // an unreached node becomes odd, and its mate even
+                search.parent[neighbor] = node;
+                search.reached.push_back(neighbor);
+                if (search.mate[neighbor] == MATCH_NONE) {
+                    return neighbor; // augmenting path
+                }
+                const uint32_t mate = search.mate[neighbor];
+                search.even[mate] = true;
+                search.queue.push_back(mate);
+                search.reached.push_back(mate);
+            }
+        }
+    }
+
+    return MATCH_NONE;
+}
+
+/****************************************************************************
+ * find_max_matching
+ *
+ * - Finds a maximum matching with Edmonds' blossom algorithm, starting from a
+ * greedy matching (lowest degree nodes first) and then augmenting from each
+ * node that's still uncovered
+ *
+ * Parameters :
+ * - graph : the graph
+ * - search : scratch space, sized here. Its mate array holds the matching
+ * afterwards
+ *
+ * Returns :
+ * - uint32_t : the number of edges in the matching
+ ****************************************************************************/
+template <typename NODE_T>
+uint32_t find_max_matching(const ADJACENCY_CSR_T<NODE_T> &__restrict graph,
+                           MATCHING_SEARCH &__restrict search) {
+    const uint32_t num_nodes = (uint32_t)graph.num_nodes;
+    search.mate.assign(num_nodes, MATCH_NONE);
+    search.parent.assign(num_nodes, MATCH_NONE);
+    search.blossom.resize(num_nodes);
+    search.base.resize(num_nodes);
+    for (uint32_t node = 0; node < num_nodes; node++) {
+        search.blossom[node] = node;
+        search.base[node] = node;
+    }
+    search.even.assign(num_nodes, false);
+    search.queue.reserve(num_nodes);
+    search.reached.clear();
+    search.reached.reserve(num_nodes);
+    search.mark.assign(num_nodes, 0);
+    search.mark_stamp = 0;
+    search.removed.assign(num_nodes, false);
+    uint32_t size = 0;
+
+    std::vector<uint32_t> by_degree(num_nodes);
+    for (uint32_t node = 0; node < num_nodes; node++) {
+        by_degree[node] = node;
+    }
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&graph](const uint32_t node_1, const uint32_t node_2) {
+                         return graph.offsets[node_1 + 1] -
+                                    graph.offsets[node_1] <
+                                graph.offsets[node_2 + 1] -
+                                    graph.offsets[node_2];
+                     });
+    for (const uint32_t node : by_degree) {
+        if (search.mate[node] != MATCH_NONE) {
+            continue;
+        }
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            const uint32_t neighbor = graph.neighbors[adj_index];
+            if (neighbor != node && search.mate[neighbor] == MATCH_NONE) {
+                search.mate[node] = neighbor;
+                search.mate[neighbor] = node;
+                size++;
+                break;
+            }
+        }
+    }
+
+    std::vector<uint32_t> root(1);
+    for (uint32_t node = 0; node < num_nodes; node++) {
+        if (search.mate[node] != MATCH_NONE) {
+            continue;
+        }
+        root[0] = node;
+        uint32_t end = grow_alternating_forest(graph, search, root);
+        if (end == MATCH_NONE) {
+            // no augmenting path will ever go through a tree that didn't
+            // find one (it stays that way as the matching grows), so its
+            // nodes can be left out of the searches from here on
+            for (const uint32_t reached : search.reached) {
+                search.removed[reached] = true;
+            }
+            continue;
+        }
+        // flip the matching along the path back to the root
+        while (end != MATCH_NONE) {
+            const uint32_t prev = search.parent[end];
+            const uint32_t next = search.mate[prev];
+            search.mate[end] = prev;
+            search.mate[prev] = end;
+            end = next;
+        }
+        size++;
+    }
+
+    return size;
+}
+
+/****************************************************************************
+ * find_inessential_nodes
+ *
+ * - Finds the nodes that some maximum matching leaves uncovered (the set D of
+ * the Gallai-Edmonds decomposition): the even nodes of the alternating forest
+ * grown from every node a maximum matching leaves uncovered
+ *
+ * Parameters :
+ * - graph : the graph
+ * - inessential_out : set to true for each inessential node, false for the
+ * nodes every maximum matching covers
+ *
+ * Returns :
+ * - uint32_t : the size of a maximum matching
+ ****************************************************************************/
+template <typename NODE_T>
+uint32_t find_inessential_nodes(const ADJACENCY_CSR_T<NODE_T> &__restrict graph,
+                                std::vector<bool> *__restrict inessential_out) {
+    MATCHING_SEARCH search;
+    const uint32_t size = find_max_matching(graph, search);
+
+    std::vector<uint32_t> roots;
+    for (uint32_t node = 0; node < (uint32_t)graph.num_nodes; node++) {
+        if (search.mate[node] == MATCH_NONE) {
+            roots.push_back(node);
+        }
+    }
+    // (with a perfect matching there aren't any roots, and nothing's even)
+    std::fill(search.removed.begin(), search.removed.end(), false);
+    grow_alternating_forest(graph, search, roots);
+    *inessential_out = search.even;
+
+    return size;
+}
@@ -7,8 +7,9 @@
 
 #include "Adjacency_Matrix.h"
 #include "Cycle_Games.h"
-// #include "Cycle_Games_Threaded.h" // no reason to include until it's
-// useful...
+#include "Graph_File.h"
+// (the threaded solver in Cycle_Games_Threaded.h is only reachable from the
+// command line, with -j, see Batch.h)
 #include "Misc.h"
 #include <chrono> // testing purposes...
 
@@ -386,24 +387,36 @@ void user_plays(const std::filesystem::path adj_info_path) {
         return;
     }
 
-    uint_fast16_t num_nodes = 0;
     bool load_success = false;
-    std::vector<Adjacency_Info> adj_info = load_adjacency_info(
-        adj_info_path, &num_nodes,
-        &load_success); // call returns pointer to the adjacency matrix, and
-                        // sets the value of num_nodes
+    const ANY_ADJACENCY_CSR loaded_graph = load_graph(
+        adj_info_path,
+        &load_success); // call returns the graph in CSR form, which holds the
+                        // number of nodes
     if (load_success == false) [[unlikely]] {
         DISPLAY_ERR(
             true,
             "An error occurred while attempting to load adjacency information");
         return;
     }
+    // the searches only run on graphs with 16 bit node labels, anything bigger
+    // is left to the command line mode's AAC matching solver
+    if (!std::holds_alternative<ADJACENCY_CSR>(loaded_graph)) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "The graph has %u nodes, but games can only be played on "
+                    "graphs with at most %u nodes here. AAC can still be "
+                    "solved for it in the command line mode (--games aac).",
+                    (unsigned)graph_num_nodes(loaded_graph),
+                    (unsigned)ADJ_NARROW_MAX_NODES);
+        return;
+    }
+    const ADJACENCY_CSR &adj_info = std::get<ADJACENCY_CSR>(loaded_graph);
+    const uint_fast16_t num_nodes = adj_info.num_nodes;
     if (!(num_nodes > 0)) [[unlikely]] {
         DISPLAY_ERR(
             true,
             "Recieved invalid graph parameter (number of graphs nodes) after "
-            "attempting to load adjacency information. Value: %hu",
-            (uint16_t)num_nodes);
+            "attempting to load adjacency information. Value: %u",
+            (unsigned)num_nodes);
         return;
     }
 
@@ -458,6 +471,83 @@ void user_plays(const std::filesystem::path adj_info_path) {
         }
     } while (!(output_select >= 0 && output_select <= 2));
 
+    // quiet AAC runs don't have to search at all (see play_AAC_matching)
+    AAC_SOLVER aac_solver = AAC_SOLVER::SEARCH;
+    if (output_select == 0 && game_select == 1) {
+        bad_input = false;
+        std::string solver_select_raw;
+        uint_fast16_t solver_select = (uint_fast16_t)AAC_SOLVER::NUM_SOLVERS;
+        printf("AAC solver:\n");
+        printf("[0] Maximum matching (fast)\n");
+        printf("[1] Search\n");
+        printf("[2] Both (check the search against the matching)\n");
+        do {
+            if (bad_input) {
+                erase_lines(2);
+            }
+            bad_input = true;
+            std::cin >> solver_select_raw;
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (!is_number(solver_select_raw) || solver_select_raw.size() > 9) {
+                continue;
+            }
+            solver_select = std::stoul(solver_select_raw, NULL);
+        } while (!(solver_select < (uint_fast16_t)AAC_SOLVER::NUM_SOLVERS));
+        aac_solver = (AAC_SOLVER)solver_select;
+    }
+    const bool searching =
+        output_select == 0 && aac_solver != AAC_SOLVER::MATCHING;
+
+    // for quiet runs that search, prompt user for the transposition table's
+    // size
+    uint_fast32_t tt_size_mb = 0;
+    if (searching) {
+        bad_input = false;
+        std::string tt_size_raw;
+        printf("Transposition table size in MB (%d is a good default):\n",
+               TT_DEFAULT_SIZE_MB);
+        printf("[0] No transposition table\n");
+        do {
+            if (bad_input) {
+                erase_lines(2);
+            }
+            bad_input = true;
+            std::cin >> tt_size_raw;
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        } while (!is_number(tt_size_raw) || tt_size_raw.size() > 9);
+        tt_size_mb = std::stoul(tt_size_raw, NULL);
+    }
+
+    // ...and for the order to try moves in
+    MOVE_ORDER move_order = MOVE_ORDER::MOBILITY;
+    if (searching) {
+        bad_input = false;
+        std::string order_select_raw;
+        uint_fast16_t order_select = (uint_fast16_t)MOVE_ORDER::NUM_ORDERS;
+        printf("Move ordering (%s is a good default):\n",
+               MOVE_ORDER_NAMES[(size_t)MOVE_ORDER::MOBILITY]);
+        for (size_t order = 0; order < (size_t)MOVE_ORDER::NUM_ORDERS;
+             order++) {
+            printf("[%zu] %s\n", order, MOVE_ORDER_NAMES[order]);
+        }
+        do {
+            if (bad_input) {
+                erase_lines(2);
+            }
+            bad_input = true;
+            std::cin >> order_select_raw;
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (!is_number(order_select_raw) || order_select_raw.size() > 9) {
+                continue;
+            }
+            order_select = std::stoul(order_select_raw, NULL);
+        } while (!(order_select < (uint_fast16_t)MOVE_ORDER::NUM_ORDERS));
+        move_order = (MOVE_ORDER)order_select;
+    }
+
     // if the user asked for a loud run, make sure the results directory is all
     // set up
     std::filesystem::path result_path;
@@ -470,13 +560,19 @@ void user_plays(const std::filesystem::path adj_info_path) {
         }
     }
 
-    // prompt user for starting node on graph
+    // prompt user for starting node on graph (quiet runs can also do every
+    // starting node at once)
     bad_input = false;
     std::string node_select_raw;
     uint_fast16_t node_select = num_nodes;
+    const uint_fast32_t all_starts_select = (uint_fast32_t)num_nodes + 1;
+    bool all_starts = false;
     printf("Select the starting node:\n");
-    printf("[0 - %hu] Said node\n", (uint16_t)(num_nodes - 1));
-    printf("[%hu] [BACK]\n", (uint16_t)num_nodes);
+    printf("[0 - %u] Said node\n", (unsigned)(num_nodes - 1));
+    printf("[%u] [BACK]\n", (unsigned)num_nodes);
+    if (output_select == 0) {
+        printf("[%lu] All starting nodes\n", (unsigned long)all_starts_select);
+    }
     do {
         if (bad_input) {
             erase_lines(2);
@@ -485,31 +581,125 @@ void user_plays(const std::filesystem::path adj_info_path) {
         std::cin >> node_select_raw;
         std::cin.clear();
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        if (!is_number(node_select_raw)) [[unlikely]] {
+        if (!is_number(node_select_raw) || node_select_raw.size() > 9)
+            [[unlikely]] {
             continue;
         }
-        node_select = std::stoul(node_select_raw, NULL);
-        if (node_select == num_nodes) { // [BACK] option
+        const uint_fast32_t selection = std::stoul(node_select_raw, NULL);
+        if (selection == num_nodes) { // [BACK] option
             return;
         }
+        if (output_select == 0 && selection == all_starts_select) {
+            all_starts = true;
+            node_select = 0; // every game gets its own start node later on
+            break;
+        }
+        node_select = selection < num_nodes ? selection : num_nodes;
     } while (!(node_select >= 0 && node_select < num_nodes));
 
     // Now that all of the options have been specified, it's time to set up to
     // actually play the game as requested
-    std::vector<EDGE_STATE> edge_use(num_nodes * num_nodes,
-                                     EDGE_STATE::NOT_USED);
-    std::vector<NODE_STATE> node_use(num_nodes, NODE_STATE::NOT_USED);
+    // (both lists start out with every entry NOT_USED)
+    PACKED_STATES<EDGE_STATE> edge_use(adj_info.num_edges);
+    PACKED_STATES<NODE_STATE> node_use(num_nodes);
 
     // Have to mark the starting node as used!
-    node_use[node_select] = NODE_STATE::USED;
+    node_use.set(node_select, NODE_STATE::USED);
     GAME_STATE game_result;
-    if (output_select == 0) {   // Quiet
+    SEARCH_CONTEXT context;
+    std::vector<GAME_STATE> matching_results;
+    if (output_select == 0 && aac_solver != AAC_SOLVER::SEARCH) {
+        const uint32_t matching_size =
+            play_AAC_matching(adj_info, &matching_results);
+        printf("Maximum matching: %lu edge(s)\n", (unsigned long)matching_size);
+    }
+    if (output_select == 0 && aac_solver == AAC_SOLVER::MATCHING) {
+        if (all_starts) {
+            printf("\n\nFile: %s, All Starting Nodes, Game: AAC\n",
+                   adj_info_path.filename().string().c_str());
+            for (uint_fast16_t start = 0; start < num_nodes; start++) {
+                printf("Starting Node: %u, ", (unsigned)start);
+                print_game_results(matching_results[start]);
+            }
+
+            printf("Press [ENTER] to continue\n");
+            char throw_away = std::getchar();
+            return;
+        }
+        game_result = matching_results[node_select];
+    } else if (output_select == 0) { // Quiet
+        ZOBRIST_KEYS zobrist;
+        TRANSPOSITION_TABLE table;
+        AUTOMORPHISM_GROUP symmetry;
+        bool use_table = false;
+        GRAPH_BRIDGES bridges;
+        find_bridges(adj_info, &bridges);
+        SERIES_CHAINS series;
+        find_series_chains(adj_info, &series);
+        if (tt_size_mb > 0) {
+            use_table = tt_init(&table, tt_size_mb, num_nodes);
+            if (!use_table) [[unlikely]] {
+                DISPLAY_ERR(false, "Requested transposition table size is too "
+                                   "small to hold any positions, playing "
+                                   "without one.");
+            } else {
+                zobrist = zobrist_init(num_nodes);
+            }
+        }
+        if (use_table || all_starts) {
+            find_automorphisms(adj_info, &symmetry);
+        }
+        init_search_context(&context, &zobrist, use_table ? &table : NULL,
+                            &symmetry, node_select);
+        set_move_order(&context, move_order, num_nodes);
+        set_bridges(&context, adj_info, &bridges);
+        set_series_chains(&context, &series);
+        set_region_keys(&context, adj_info);
+
+        if (all_starts) {
+            std::vector<GAME_STATE> results;
+            const std::vector<uint16_t> orbit_rep = find_orbits(symmetry);
+            const size_t num_games = play_all_starts_quiet(
+                game_select == 0, adj_info, orbit_rep, context, &results);
+            print_search_stats(context);
+
+            printf("\n\nFile: %s, All Starting Nodes, Game: %s\n",
+                   adj_info_path.filename().string().c_str(),
+                   game_select == 0 ? "MAC" : "AAC");
+            printf("Played %zu game(s), one per starting node orbit\n",
+                   num_games);
+            for (uint_fast16_t start = 0; start < num_nodes; start++) {
+                printf("Starting Node: %u, ", (unsigned)start);
+                if (orbit_rep[start] != start) {
+                    printf("(same orbit as node %u) ",
+                           (unsigned)orbit_rep[start]);
+                }
+                print_game_results(results[start]);
+                if (!matching_results.empty() &&
+                    results[start] != GAME_STATE::KILL_STATE &&
+                    results[start] != matching_results[start]) [[unlikely]] {
+                    printf("  (the maximum matching disagrees!)\n");
+                }
+            }
+
+            printf("Press [ENTER] to continue\n");
+            char throw_away = std::getchar();
+            return;
+        }
+
         if (game_select == 0) { // MAC
-            game_result = play_MAC_quiet(node_select, num_nodes, adj_info,
-                                         edge_use, node_use);
+            game_result = play_MAC_iterative(node_select, adj_info, edge_use,
+                                             node_use, context);
         } else { // AAC
-            game_result = play_AAC_quiet(node_select, num_nodes, adj_info,
-                                         edge_use, node_use);
+            game_result = play_AAC_iterative(node_select, adj_info, edge_use,
+                                             node_use, context);
+        }
+        // the table goes away with this scope, so grab its counters first
+        print_search_stats(context);
+        if (!matching_results.empty() &&
+            game_result != matching_results[node_select]) [[unlikely]] {
+            DISPLAY_ERR(false, "The search and the maximum matching disagree "
+                               "on this game's result!");
         }
     } else { // Loud
         std::vector<uint_fast16_t> move_hist(num_nodes);
@@ -549,12 +739,12 @@ void user_plays(const std::filesystem::path adj_info_path) {
         }
         if (game_select == 0) { // MAC
             game_result =
-                play_MAC_loud(node_select, num_nodes, adj_info, edge_use,
-                              node_use, move_hist, 0, result_stream);
+                play_MAC_loud(node_select, adj_info, edge_use, node_use,
+                              move_hist, 0, result_stream);
         } else { // AAC
             game_result =
-                play_AAC_loud(node_select, num_nodes, adj_info, edge_use,
-                              node_use, move_hist, 0, result_stream);
+                play_AAC_loud(node_select, adj_info, edge_use, node_use,
+                              move_hist, 0, result_stream);
         }
 
         if (result_stream != NULL)
@@ -570,8 +760,8 @@ void user_plays(const std::filesystem::path adj_info_path) {
         }
     }
 
-    printf("\n\nFile: %s, Starting Node: %hu, Game: %s\n",
-           adj_info_path.filename().string().c_str(), (uint16_t)node_select,
+    printf("\n\nFile: %s, Starting Node: %u, Game: %s\n",
+           adj_info_path.filename().string().c_str(), (unsigned)node_select,
            game_select == 0 ? "MAC" : "AAC");
     print_game_results(game_result);
 
@@ -794,6 +984,132 @@ std::string get_adj_info_file_name(const uint_fast16_t graph_fam,
 // Might want to re-organize here, a lot of redundant code
 // maybe create separate parameter checking functions for each graph family...
 
+/****************************************************************************
+ * prompt_graph_file_format
+ *
+ * - Asks the user whether a generated graph should be written as a text
+ * adjacency listing or as a graph file (see Graph_File.h)
+ *
+ * Parameters :
+ * - none
+ *
+ * Returns :
+ * - bool : true for a graph file
+ ****************************************************************************/
+bool prompt_graph_file_format() {
+    std::string format_raw;
+    uint_fast16_t format = 2;
+    bool bad_input = false;
+    printf("File format:\n");
+    printf("[0] Text adjacency listing (.txt)\n");
+    printf("[1] Graph file (%s, loads without any parsing)\n", GRAPH_FILE_EXT);
+    do {
+        if (bad_input) {
+            erase_lines(2);
+        }
+        bad_input = true;
+        std::cin >> format_raw;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (!is_number(format_raw) || format_raw.size() > 9) {
+            continue;
+        }
+        format = std::stoul(format_raw, NULL);
+    } while (!(format <= 1));
+
+    return format == 1;
+}
+
+/****************************************************************************
+ * write_generated_graph
+ *
+ * - Runs a generating function, and writes what it puts out to the given path
+ * as a text adjacency listing or as a graph file
+ *
+ * Parameters :
+ * - output_path : where to write the graph. For a graph file the extension
+ * gets swapped for GRAPH_FILE_EXT
+ * - graph_file : true to write a graph file, false for a text listing
+ * - family : the graph's family
+ * - params : the graph's parameters
+ * - generate : calls the actual generation function with the parameters,
+ * returns false if generation failed
+ *
+ * Returns :
+ * - bool : false if the file couldn't be written (an error has been shown)
+ ****************************************************************************/
+bool write_generated_graph(std::filesystem::path *__restrict output_path,
+                           const bool graph_file, const GRAPH_FAMILY family,
+                           const std::vector<uint32_t> &__restrict params,
+                           bool (*generate)(ADJ_LIST_OUT &,
+                                            const std::vector<uint32_t> &)) {
+    if (graph_file) {
+        output_path->replace_extension(GRAPH_FILE_EXT);
+        std::vector<ADJ_LIST_ENTRY> entries;
+        ADJ_LIST_OUT gen_output;
+        gen_output.entries = &entries;
+        if (!generate(gen_output, params)) [[unlikely]] {
+            DISPLAY_ERR(false,
+                        "Failed to generate adjacency matrix! Returning...");
+            return false;
+        }
+        if (!write_graph_file(*output_path, entries, family, params))
+            [[unlikely]] {
+            DISPLAY_ERR(true, "Failed to write the graph file.");
+            return false;
+        }
+        return true;
+    }
+
+    FILE *output;
+#ifdef _WIN32 // might as well use Microsoft's error reporting if we're on a
+              // windows machine
+    _set_errno(0); // "Always clear errno by calling _set_errno(0) immediately
+                   // before a call that may set it"
+    errno_t err = fopen_s(&output, output_path->string().c_str(), "w");
+#else
+    output = fopen(output_path->string().c_str(), "w");
+#endif // WIN32
+
+#ifdef _WIN32
+    if (err != 0) [[unlikely]] {
+        char err_buff
+            [ERRNO_STRING_LEN]; // (https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/strerror-s-strerror-s-wcserror-s-wcserror-s?view=msvc-170)
+        strerror_s(err_buff, ERRNO_STRING_LEN, NULL);
+        DISPLAY_ERR(true,
+                    "Failed to open the result output file.\nRequested path: "
+                    "%s\nfopen_s error message: %s",
+                    output_path->string().c_str(), err_buff);
+#else
+    if (output == NULL) [[unlikely]] {
+        DISPLAY_ERR(
+            true, "Failed to open the result output file.\nRequested path: %s",
+            output_path->string().c_str());
+#endif // WIN32
+        return false;
+    }
+
+    ADJ_LIST_OUT gen_output;
+    gen_output.text = output;
+    const bool success =
+        generate(gen_output, params); // call the actual generation function
+
+    int close_err = fclose(output);
+    if (close_err != 0) [[unlikely]] {
+        DISPLAY_ERR(true,
+                    "Failed to properly close the output file.\nPath "
+                    "associated with file stream: %s",
+                    output_path->string().c_str());
+        return false;
+    }
+
+    if (!success) [[unlikely]] {
+        DISPLAY_ERR(false, "Failed to generate adjacency matrix! Returning...");
+        return false;
+    }
+    return true;
+}
+
 /****************************************************************************
  * user_generalized_petersen_gen
  *
@@ -844,8 +1160,8 @@ void user_generalized_petersen_gen() {
     } while (!(n_param >= 3) || !(k_param >= 1) ||
              !(k_param <= ((n_param - 1) / 2)));
 
+    const bool graph_file = prompt_graph_file_format();
     printf("Generating graph...");
-    FILE *output;
 
     std::filesystem::path output_path;
     if (!verify_adj_info_path(&output_path, false, GEN_MENU_GEN_PET_ENTRY))
@@ -859,49 +1175,15 @@ void user_generalized_petersen_gen() {
         get_adj_info_file_name(GEN_MENU_GEN_PET_ENTRY, 2, n_param, k_param);
     output_path.append(file_name);
 
-    // can check if file exists here if we want to do some kind of
-    // versioning....
-
-#ifdef _WIN32 // might as well use Microsoft's error reporting if we're on a
-              // windows machine
-    _set_errno(0); // "Always clear errno by calling _set_errno(0) immediately
-                   // before a call that may set it"
-    errno_t err = fopen_s(&output, output_path.string().c_str(), "w");
-#else
-    output = fopen(output_path.string().c_str(), "w");
-#endif // WIN32
-
-#ifdef _WIN32
-    if (err != 0) [[unlikely]] {
-        char err_buff
-            [ERRNO_STRING_LEN]; // (https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/strerror-s-strerror-s-wcserror-s-wcserror-s?view=msvc-170)
-        strerror_s(err_buff, ERRNO_STRING_LEN, NULL);
-        DISPLAY_ERR(true,
-                    "Failed to open the result output file.\nRequested path: "
-                    "%s\nfopen_s error message: %s",
-                    output_path.string().c_str(), err_buff);
-#else
-    if (output == NULL) [[unlikely]] {
-        DISPLAY_ERR(
-            true, "Failed to open the result output file.\nRequested path: %s",
-            output_path.string().c_str());
-#endif // WIN32
+    if (!write_generated_graph(
+            &output_path, graph_file, GRAPH_FAMILY::GENERALIZED_PETERSEN,
+            {(uint32_t)n_param, (uint32_t)k_param},
+            [](ADJ_LIST_OUT &output, const std::vector<uint32_t> &params) {
+                return generalized_petersen_gen(output, params[0], params[1]);
+            })) [[unlikely]] {
         return;
     }
 
-    generalized_petersen_gen(output, n_param,
-                             k_param); // call the actual generation function
-    if (output != NULL) [[likely]] {
-        int close_err = fclose(output);
-        if (close_err != 0) [[unlikely]] {
-            DISPLAY_ERR(true,
-                        "Failed to properly close the output file.\nPath "
-                        "associated with file stream: %s",
-                        output_path.string().c_str());
-            return;
-        }
-    }
-
     // allow user to play game on newly generated adjacency file
     std::string exit_choice_raw;
     uint_fast16_t exit_choice = 2;
@@ -979,8 +1261,8 @@ void user_stacked_prism_gen() {
         n_param = std::stoul(n_raw, NULL);
     } while (!(m_param >= 3) || !(n_param >= 1));
 
+    const bool graph_file = prompt_graph_file_format();
     printf("Generating graph...");
-    FILE *output;
 
     std::filesystem::path output_path;
     if (!verify_adj_info_path(&output_path, false,
@@ -994,50 +1276,15 @@ void user_stacked_prism_gen() {
                                                    2, m_param, n_param);
     output_path.append(file_name);
 
-#ifdef _WIN32 // might as well use Microsoft's error reporting if we're on a
-              // windows machine
-    _set_errno(0); // "Always clear errno by calling _set_errno(0) immediately
-                   // before a call that may set it"
-    errno_t err = fopen_s(&output, output_path.string().c_str(), "w");
-#else
-    output = fopen(output_path.string().c_str(), "w");
-#endif // WIN32
-
-#ifdef _WIN32
-    if (err != 0)
-        [[unlikely]] { // Will need to tweak error reporting once we get the
-                       // generated graphs in the correct directory
-        char err_buff
-            [ERRNO_STRING_LEN]; // (https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/strerror-s-strerror-s-wcserror-s-wcserror-s?view=msvc-170)
-        strerror_s(err_buff, ERRNO_STRING_LEN, NULL);
-        DISPLAY_ERR(true,
-                    "Failed to open the result output file.\nRequested path: "
-                    "%s\nfopen_s error message: %s",
-                    output_path.string().c_str(), err_buff);
-#else
-    if (output == NULL) [[unlikely]] {
-        DISPLAY_ERR(true,
-                    "Failed to open the result output file.\nRequested path: "
-                    "%s\nfopen_s error code: %d",
-                    output_path.string().c_str());
-#endif // _WIN32
+    if (!write_generated_graph(
+            &output_path, graph_file, GRAPH_FAMILY::STACKED_PRISM,
+            {(uint32_t)m_param, (uint32_t)n_param},
+            [](ADJ_LIST_OUT &output, const std::vector<uint32_t> &params) {
+                return stacked_prism_gen(output, params[0], params[1]);
+            })) [[unlikely]] {
         return;
     }
 
-    stacked_prism_gen(output, m_param,
-                      n_param); // call the actual generation function
-
-    if (output != NULL) [[likely]] {
-        int close_err = fclose(output);
-        if (close_err != 0) [[unlikely]] {
-            DISPLAY_ERR(true,
-                        "Failed to properly close the output file.\nPath "
-                        "associated with file stream: %s",
-                        output_path.string().c_str());
-            return;
-        }
-    }
-
     // allow user to play game on newly generated adjacency file
     std::string exit_choice_raw;
     uint_fast16_t exit_choice = 2;
@@ -1116,8 +1363,8 @@ void user_z_mn_gen() {
     } while (!(m_param >= 2) // is this the correct constraint?
              || !(n_param >= 1));
 
+    const bool graph_file = prompt_graph_file_format();
     printf("Generating graph...");
-    FILE *output;
 
     std::filesystem::path output_path;
     if (!verify_adj_info_path(&output_path, false, GEN_MENU_Z_MN_ENTRY))
@@ -1131,50 +1378,12 @@ void user_z_mn_gen() {
         get_adj_info_file_name(GEN_MENU_Z_MN_ENTRY, 2, m_param, n_param);
     output_path.append(file_name);
 
-#ifdef _WIN32 // might as well use Microsoft's error reporting if we're on a
-              // windows machine
-    _set_errno(0); // "Always clear errno by calling _set_errno(0) immediately
-                   // before a call that may set it"
-    errno_t err = fopen_s(&output, output_path.string().c_str(), "w");
-#else
-    output = fopen(output_path.string().c_str(), "w");
-#endif // WIN32
-
-#ifdef _WIN32
-    if (err != 0) [[unlikely]] {
-        // strerrorlen_s(err); // looks like this isn't defined on my machine :(
-        char err_buff
-            [ERRNO_STRING_LEN]; // (https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/strerror-s-strerror-s-wcserror-s-wcserror-s?view=msvc-170)
-        strerror_s(err_buff, ERRNO_STRING_LEN, NULL);
-        DISPLAY_ERR(true,
-                    "Failed to open the result output file.\nRequested path: "
-                    "%s\nfopen_s error message: %s",
-                    output_path.string().c_str(), err_buff);
-#else
-    if (output == NULL) [[unlikely]] {
-        DISPLAY_ERR(
-            true, "Failed to open the result output file.\nRequested path: %s",
-            output_path.string().c_str());
-#endif // _WIN32
-        return;
-    }
-
-    bool success = z_mn_gen(output, m_param,
-                            n_param); // call the actual generation function
-
-    if (output != NULL) [[likely]] {
-        int close_err = fclose(output);
-        if (close_err != 0) [[unlikely]] {
-            DISPLAY_ERR(true,
-                        "Failed to properly close the output file.\nPath "
-                        "associated with file stream: %s",
-                        output_path.string().c_str());
-            return;
-        }
-    }
-
-    if (!success) [[unlikely]] {
-        DISPLAY_ERR(false, "Failed to generate adjacency matrix! Returning...");
+    if (!write_generated_graph(
+            &output_path, graph_file, GRAPH_FAMILY::Z_MN,
+            {(uint32_t)m_param, (uint32_t)n_param},
+            [](ADJ_LIST_OUT &output, const std::vector<uint32_t> &params) {
+                return z_mn_gen(output, params[0], params[1]);
+            })) [[unlikely]] {
         return;
     }
 
@@ -0,0 +1,261 @@
+#pragma once
+/*
+ *
+ * - This file holds a check for mirroring (pairing) strategies, which settle
+ * plenty of the graph families in the Cycle Games on Graphs paper without any
+ * real searching
+ * - The idea: take an automorphism of the graph that swaps nodes in pairs (an
+ * involution), ideally with every node adjacent to the node it's swapped with.
+ * Whenever the other player moves onto a node, the mirroring player answers by
+ * moving to that node's partner. If every such answer is always legal, the
+ * mirroring player always has a move and wins
+ * - Whether the answers really are always legal depends on the starting node
+ * (it's visited without its partner) and on the game, so a candidate gets
+ * checked by playing it out: only the other player's moves branch, the
+ * mirroring player's are forced, so that's a much smaller tree than the game's.
+ * In MAC the mirroring player also takes any cycle it can close, and loses the
+ * check as soon as the other player can close one
+ * - Player 2 can mirror right from the start, or player 1 can make an opening
+ * move and mirror from then on. The first makes the game a LOSS for player 1,
+ * the second a WIN
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Automorphism.h"
+#include "Cycle_Games.h"
+#include "Packed_State.h"
+
+// Give up on finding a mirroring strategy after this many positions
+#define MIRROR_MAX_POSITIONS ((uint64_t)1 << 14)
+
+// Stand in for "no opening move" (player 2 does the mirroring)
+#define MIRROR_NO_OPENING UINT16_MAX
+
+// Stand in for "not adjacent to its partner"
+#define MIRROR_NO_EDGE UINT32_MAX
+
+typedef struct MIRROR_STRATEGY {
+    std::vector<uint16_t> involution; // the pairing, empty if none was found
+    uint16_t opening = MIRROR_NO_OPENING; // player 1's first move, if any
+    GAME_STATE result = GAME_STATE::KILL_STATE; // KILL_STATE if none found
+    uint64_t positions = 0; // positions played out checking candidates
+} MIRROR_STRATEGY;
+
+// Everything a candidate's check needs while it plays the game out
+typedef struct MIRROR_CHECK {
+    const ADJACENCY_CSR *graph = NULL;
+    std::vector<uint32_t> partner_edge; // by node, edge to its partner
+    const uint16_t *partner = NULL;     // the candidate involution
+    PACKED_STATES<EDGE_STATE> edge_use_list;
+    PACKED_STATES<NODE_STATE> node_use_list;
+    uint64_t positions = 0;
+} MIRROR_CHECK;
+
+template <bool MAC>
+bool mirror_answers(MIRROR_CHECK &__restrict check, const uint_fast16_t node);
+
+/****************************************************************************
+ * mirror_reply
+ *
+ * - Plays the mirroring player's move from node: closes a cycle if there's
+ * one to close (MAC), otherwise moves to node's partner
+ *
+ * Parameters :
+ * - check : the candidate's check in progress
+ * - node : the node the other player just moved to
+ *
+ * Returns :
+ * - bool : true if the mirroring player wins from here
+ ****************************************************************************/
+template <bool MAC>
+bool mirror_reply(MIRROR_CHECK &__restrict check, const uint_fast16_t node) {
+    const ADJACENCY_CSR &graph = *check.graph;
+    if (++check.positions > MIRROR_MAX_POSITIONS) [[unlikely]] {
+        return false;
+    }
+    if constexpr (MAC) {
+        for (uint32_t adj_index = graph.offsets[node];
+             adj_index < graph.offsets[node + 1]; adj_index++) {
+            if (check.edge_use_list.get(graph.edge_ids[adj_index]) ==
+                    EDGE_STATE::NOT_USED &&
+                check.node_use_list.get(graph.neighbors[adj_index]) ==
+                    NODE_STATE::USED) {
+                return true;
+            }
+        }
+    }
+
+    // the answer has to be free, or the strategy's broken
+    const uint_fast16_t partner = check.partner[node];
+    const uint32_t edge = check.partner_edge[node];
+    if (edge == MIRROR_NO_EDGE ||
+        check.edge_use_list.get(edge) == EDGE_STATE::USED ||
+        check.node_use_list.get(partner) == NODE_STATE::USED) {
+        return false;
+    }
+    check.edge_use_list.set(edge, EDGE_STATE::USED);
+    check.node_use_list.set(partner, NODE_STATE::USED);
+    const bool wins = mirror_answers<MAC>(check, partner);
+    check.edge_use_list.set(edge, EDGE_STATE::NOT_USED);
+    check.node_use_list.set(partner, NODE_STATE::NOT_USED);
+    return wins;
+}
+
+/****************************************************************************
+ * mirror_answers
+ *
+ * - Tries every move the other player has from node, each answered by the
+ * mirroring player (see mirror_reply)
+ *
+ * Parameters :
+ * - check : the candidate's check in progress
+ * - node : the node the mirroring player just moved to
+ *
+ * Returns :
+ * - bool : true if the mirroring player wins whatever the other player does
+ ****************************************************************************/
+template <bool MAC>
+bool mirror_answers(MIRROR_CHECK &__restrict check, const uint_fast16_t node) {
+    const ADJACENCY_CSR &graph = *check.graph;
+    if (++check.positions > MIRROR_MAX_POSITIONS) [[unlikely]] {
+        return false;
+    }
+    for (uint32_t adj_index = graph.offsets[node];
+         adj_index < graph.offsets[node + 1]; adj_index++) {
+        const uint32_t edge = graph.edge_ids[adj_index];
+        const uint16_t neighbor = graph.neighbors[adj_index];
+        if (check.edge_use_list.get(edge) == EDGE_STATE::USED) {
+            continue;
+        }
+        if (check.node_use_list.get(neighbor) == NODE_STATE::USED) {
+            if constexpr (MAC) { // the other player closes a cycle
+                return false;
+            } else {
+                continue;
+            }
+        }
+        check.edge_use_list.set(edge, EDGE_STATE::USED);
+        check.node_use_list.set(neighbor, NODE_STATE::USED);
+        const bool wins = mirror_reply<MAC>(check, neighbor);
+        check.edge_use_list.set(edge, EDGE_STATE::NOT_USED);
+        check.node_use_list.set(neighbor, NODE_STATE::NOT_USED);
+        if (!wins) {
+            return false;
+        }
+    }
+    return true; // out of moves, or every one of them got answered
+}
+
+/****************************************************************************
+ * find_mirror_strategy
+ *
+ * - Looks through a graph's automorphisms for one that gives a mirroring
+ * strategy (see the top of this file) for the given game and starting node
+ * - Player 2 mirroring is tried first, then player 1 after each opening move
+ * - Gives up (and the game has to be searched) after MIRROR_MAX_POSITIONS
+ * positions across every candidate
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph
+ * - group : the graph's automorphisms
+ * - play_MAC : true for MAC, false for AAC
+ * - start : the starting node
+ * - strategy_out : where the strategy found is written, along with the
+ * game's result
+ *
+ * Returns :
+ * - bool : whether a strategy was found
+ ****************************************************************************/
+bool find_mirror_strategy(const ADJACENCY_CSR &__restrict graph,
+                          const AUTOMORPHISM_GROUP &__restrict group,
+                          const bool play_MAC,
+                          const uint_fast16_t start,
+                          MIRROR_STRATEGY *__restrict strategy_out) {
+    const uint_fast16_t num_nodes = graph.num_nodes;
+    *strategy_out = MIRROR_STRATEGY{};
+    if (group.num_nodes != num_nodes) [[unlikely]] {
+        return false;
+    }
+
+    MIRROR_CHECK check;
+    check.graph = &graph;
+    check.partner_edge.resize(num_nodes);
+    check.edge_use_list = PACKED_STATES<EDGE_STATE>(graph.num_edges);
+    check.node_use_list = PACKED_STATES<NODE_STATE>(num_nodes);
+    check.node_use_list.set(start, NODE_STATE::USED);
+    // whether the mirroring player wins once the other player's to move
+    auto plays_out = [&check, play_MAC](const uint_fast16_t node) {
+        return play_MAC ? mirror_answers<true>(check, node)
+                        : mirror_answers<false>(check, node);
+    };
+
+    for (size_t index = 0; index < group.size(); index++) {
+        const uint16_t *perm = group.perm(index);
+        bool involution = false; // and not the identity
+        for (uint_fast16_t node = 0; node < num_nodes; node++) {
+            const uint_fast16_t partner = perm[node];
+            if (perm[partner] != node) {
+                involution = false;
+                break;
+            }
+            involution |= partner != node;
+            // nodes that aren't next to their partner (or are their own) can
+            // be left in, as long as the other player never gets to them
+            const auto row_begin = graph.neighbors + graph.offsets[node];
+            const auto row_end = graph.neighbors + graph.offsets[node + 1];
+            const auto found =
+                std::lower_bound(row_begin, row_end, (uint16_t)partner);
+            check.partner_edge[node] =
+                found != row_end && *found == partner
+                    ? graph.edge_ids[found - graph.neighbors]
+                    : MIRROR_NO_EDGE;
+        }
+        if (!involution) {
+            continue;
+        }
+        check.partner = perm;
+
+        // player 2 mirrors player 1's every move
+        GAME_STATE result = GAME_STATE::KILL_STATE;
+        uint16_t opening = MIRROR_NO_OPENING;
+        if (plays_out(start)) {
+            result = GAME_STATE::LOSS_STATE;
+        }
+        // player 1 moves somewhere, then mirrors player 2
+        for (uint32_t adj_index = graph.offsets[start];
+             adj_index < graph.offsets[start + 1] &&
+             result == GAME_STATE::KILL_STATE &&
+             check.positions <= MIRROR_MAX_POSITIONS;
+             adj_index++) {
+            const uint16_t neighbor = graph.neighbors[adj_index];
+            check.edge_use_list.set(graph.edge_ids[adj_index],
+                                    EDGE_STATE::USED);
+            check.node_use_list.set(neighbor, NODE_STATE::USED);
+            if (plays_out(neighbor)) {
+                result = GAME_STATE::WIN_STATE;
+                opening = neighbor;
+            }
+            check.edge_use_list.set(graph.edge_ids[adj_index],
+                                    EDGE_STATE::NOT_USED);
+            check.node_use_list.set(neighbor, NODE_STATE::NOT_USED);
+        }
+
+        strategy_out->positions = check.positions;
+        if (check.positions > MIRROR_MAX_POSITIONS) {
+            return false; // out of positions
+        }
+        if (result != GAME_STATE::KILL_STATE) {
+            strategy_out->involution.assign(perm, perm + num_nodes);
+            strategy_out->opening = opening;
+            strategy_out->result = result;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -42,6 +42,11 @@
 #endif       // __clang__ || __GNUC__
 #endif       // !WIN32
 
+// Set by the command line (batch) mode. There's nobody around to press
+// [ENTER] to clear an error, and stdout is reserved for results, so errors go
+// to stderr instead
+inline bool headless_mode = false;
+
 // going to define the below function-like macro expression to ease the use of
 // the display_error function someone editing the code can skip passing in
 // __FILE__, _LINE__, __FUNCSIG__ as the first args to display_error...
@@ -78,18 +83,19 @@
 void display_error(const char *__restrict file_name, const int line_num,
                    const char *__restrict func_sig, const bool user_clear,
                    const char *__restrict err_msg, ...) {
-    printf("ERROR: ");
+    FILE *err_stream = headless_mode ? stderr : stdout;
+    fprintf(err_stream, "ERROR: ");
 
     va_list arg_ptr;
     va_start(arg_ptr, err_msg);
-    vprintf(err_msg, arg_ptr);
+    vfprintf(err_stream, err_msg, arg_ptr);
     va_end(arg_ptr);
 
-    printf("\n\t[FILE] %s\n", file_name);
-    printf("\t[LINE] %d\n", line_num);
-    printf("\t[FUNC] %s\n", func_sig);
+    fprintf(err_stream, "\n\t[FILE] %s\n", file_name);
+    fprintf(err_stream, "\t[LINE] %d\n", line_num);
+    fprintf(err_stream, "\t[FUNC] %s\n", func_sig);
 
-    if (user_clear) {
+    if (user_clear && !headless_mode) {
         printf("Press [ENTER] to continue...\n");
         char throw_away = std::getchar();
     }
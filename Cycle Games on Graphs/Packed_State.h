@@ -0,0 +1,66 @@
+#pragma once
+/*
+ *
+ * - This file holds the bit-packed storage used for the games' edge and node
+ * state lists
+ * - EDGE_STATE and NODE_STATE only ever take on two values, so there's no
+ * reason to spend a whole enum's worth of bytes on each entry. Instead each
+ * entry gets a single bit, which means the used edge list for a graph with E
+ * edges takes up E / 8 bytes (rounded up to a whole 64 bit word)
+ * - The enums are still what goes in and out of the lists, so the game code
+ * reads the same as it did with plain std::vectors
+ *
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/****************************************************************************
+ * PACKED_STATES
+ *
+ * - A fixed size list of two-valued states, packed one bit per entry into 64
+ * bit words
+ * - STATE_T must be an enum whose first value is 0 (e.g. NOT_USED) and whose
+ * second value is 1 (e.g. USED). A freshly constructed list has every entry
+ * set to the 0 value
+ * - The packed words are left public so that code which wants to work on the
+ * whole set at once (hashing, comparing, bit-parallel scans) can do so
+ ****************************************************************************/
+template <typename STATE_T> struct PACKED_STATES {
+    static_assert(std::is_enum_v<STATE_T>,
+                  "PACKED_STATES only holds two-valued enum states!");
+
+    std::vector<uint64_t> words;
+    size_t num_entries = 0;
+
+    PACKED_STATES() = default;
+    explicit PACKED_STATES(const size_t size)
+        : words((size + 63) / 64, 0), num_entries(size) {}
+
+    inline STATE_T get(const size_t index) const {
+        return static_cast<STATE_T>((words[index >> 6] >> (index & 63)) & 1);
+    }
+
+    inline void set(const size_t index, const STATE_T value) {
+        const uint64_t mask = (uint64_t)1 << (index & 63);
+        if (static_cast<uint64_t>(value) != 0) {
+            words[index >> 6] |= mask;
+        } else {
+            words[index >> 6] &= ~mask;
+        }
+    }
+
+    inline size_t size() const { return num_entries; }
+
+    // number of entries holding the 1 value (e.g. USED)
+    size_t count() const {
+        size_t total = 0;
+        for (const uint64_t word : words) {
+            total += std::popcount(word);
+        }
+        return total;
+    }
+};
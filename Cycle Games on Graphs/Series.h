@@ -0,0 +1,137 @@
+#pragma once
+/*
+ *
+ * - This file holds the series reduction of a graph: its maximal chains of
+ * degree 2 nodes, worked out once so the quiet search can take a whole chain
+ * in one move
+ * - Once the game steps onto a degree 2 node, every move until the far end of
+ * the chain is forced: the node it came from is visited, so there's only one
+ * way to go, in either game. Nothing along the way can touch the rest of the
+ * graph either, since the chain's nodes only have edges to each other and to
+ * its two ends. So a chain behaves like a single "super-edge" from one end to
+ * the other, and the only thing that matters about its length is the parity:
+ *	- if the far end is unvisited, the game carries on from there, with the
+ *	same player to move as at the near end if the length is even, and the
+ *	other player if it's odd
+ *	- if the far end is already visited (including a chain that loops back to
+ *	where it started), the last node of the chain is stuck next to it. In MAC
+ *	whoever's there closes a cycle and wins, in AAC they're out of moves and
+ *	lose
+ * - The chain nodes still get marked as visited and the chain's edges as used
+ * when the search takes a chain, so positions look exactly the same as if the
+ * chain had been walked one node at a time (same node numbers, same table
+ * keys, same logs). Nothing needs un-contracting afterwards
+ * - Chains are only recorded from nodes that aren't of degree 2 themselves,
+ * so a game starting partway along a chain walks that one the slow way (see
+ * SERIES_CHAINS::interior_chain)
+ *
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+
+// Stand in for "no chain"
+#define SERIES_NONE UINT32_MAX
+
+// One chain, as taken from one of its ends
+typedef struct SERIES_CHAIN {
+    uint16_t end = 0;        // node at the far end
+    uint32_t length = 0;     // edges from the near end to the far end
+    uint32_t node_begin = 0; // first of the length - 1 interior nodes
+    uint32_t edge_begin = 0; // first of the length edges, near end first
+    uint32_t id = 0;         // same for both directions of a chain
+} SERIES_CHAIN;
+
+typedef struct SERIES_CHAINS {
+    std::vector<uint32_t> chain_of; // by CSR index, the chain the move starts
+    std::vector<SERIES_CHAIN> chains;
+    std::vector<uint16_t> nodes; // interior nodes of each chain, in order
+    std::vector<uint32_t> edges; // edges of each chain, in order
+    // by node, the chain a degree 2 node is inside of. A game started inside
+    // a chain can't take any direction of that chain in one go, since it'd
+    // run into the starting node partway along
+    std::vector<uint32_t> interior_chain;
+    uint32_t num_chains = 0; // counting both directions as one
+} SERIES_CHAINS;
+
+/****************************************************************************
+ * find_series_chains
+ *
+ * - Finds every maximal chain of degree 2 nodes in a graph, and records it
+ * once from each end that isn't itself a degree 2 node
+ * - Cycles made up of nothing but degree 2 nodes don't have an end like that,
+ * and are left alone
+ * - Nodes with a self loop are never counted as degree 2 nodes, so they only
+ * ever end a chain
+ *
+ * Parameters :
+ * - graph : reference to the CSR form of the graph in question
+ * - chains_out : where the chains are written
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void find_series_chains(const ADJACENCY_CSR &__restrict graph,
+                        SERIES_CHAINS *__restrict chains_out) {
+    // a self loop only takes up one entry in its node's row, so a node with
+    // one can look like it has degree 2. It's never part of a chain though:
+    // in MAC whoever's on it can close the loop, so the moves aren't forced
+    auto chain_node = [&graph](const uint_fast16_t node) {
+        const uint32_t row = graph.offsets[node];
+        return graph.offsets[node + 1] - row == 2 &&
+               graph.neighbors[row] != node && graph.neighbors[row + 1] != node;
+    };
+    *chains_out = SERIES_CHAINS{};
+    chains_out->chain_of.assign(graph.offsets[graph.num_nodes], SERIES_NONE);
+    chains_out->interior_chain.assign(graph.num_nodes, SERIES_NONE);
+
+    for (uint_fast16_t start = 0; start < graph.num_nodes; start++) {
+        if (chain_node(start)) {
+            continue;
+        }
+        for (uint32_t adj_index = graph.offsets[start];
+             adj_index < graph.offsets[start + 1]; adj_index++) {
+            uint_fast16_t node = graph.neighbors[adj_index];
+            if (!chain_node(node)) {
+                continue;
+            }
+
+            SERIES_CHAIN chain;
+            chain.node_begin = (uint32_t)chains_out->nodes.size();
+            chain.edge_begin = (uint32_t)chains_out->edges.size();
+            uint32_t edge = graph.edge_ids[adj_index];
+            chains_out->edges.push_back(edge);
+            while (chain_node(node)) {
+                chains_out->nodes.push_back((uint16_t)node);
+                // step out the side we didn't come in on
+                const uint32_t row = graph.offsets[node];
+                const uint32_t next =
+                    graph.edge_ids[row] == edge ? row + 1 : row;
+                edge = graph.edge_ids[next];
+                node = graph.neighbors[next];
+                chains_out->edges.push_back(edge);
+            }
+            chain.end = (uint16_t)node;
+            chain.length =
+                (uint32_t)chains_out->edges.size() - chain.edge_begin;
+
+            // the chain's id comes from whichever end finds it first
+            const uint16_t first = chains_out->nodes[chain.node_begin];
+            if (chains_out->interior_chain[first] == SERIES_NONE) {
+                for (uint32_t index = chain.node_begin;
+                     index < chains_out->nodes.size(); index++) {
+                    chains_out->interior_chain[chains_out->nodes[index]] =
+                        chains_out->num_chains;
+                }
+                chains_out->num_chains++;
+            }
+            chain.id = chains_out->interior_chain[first];
+
+            chains_out->chain_of[adj_index] =
+                (uint32_t)chains_out->chains.size();
+            chains_out->chains.push_back(chain);
+        }
+    }
+}
@@ -1,6 +1,11 @@
+#include "Batch.h"
 #include "Menu.h"
 
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 1) { // any arguments at all means a command line (batch) run
+        return batch_main(argc, argv);
+    }
+
     main_menu();
 
     return 0;
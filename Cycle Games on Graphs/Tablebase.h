@@ -0,0 +1,560 @@
+#pragma once
+/*
+ *
+ * - This file holds the endgame tablebase: the results of both games on every
+ * small rooted graph, worked out ahead of time, saved to a file, and mapped
+ * into memory when a run wants to use it
+ * - Deep enough into a game, what's left to play on is often a small piece of
+ * the graph hanging off the current node, and the same small shapes turn up
+ * over and over, across games and across graphs. Looking the shape up saves
+ * searching it again
+ * - What's left to play on (the "residual graph") is the current node (the
+ * root) plus the unvisited nodes that can still be reached from it, with the
+ * edges between them:
+ *	- in AAC every unvisited node reachable through unvisited nodes counts
+ *	- in MAC, an unvisited node with an unused edge to a visited node other
+ *	than the current one is poison: whoever moves there hands the other player
+ *	a cycle. Moving there is never better than having no move at all (both
+ *	lose), so those nodes get left out, along with anything only reachable
+ *	through them. Once they're gone, nothing on the residual graph touches a
+ *	visited node other than the root, so the position plays out exactly like a
+ *	fresh game on the residual graph started from the root
+ * - So the tablebase is just keyed on rooted graphs, with no extra flags
+ * needed for visited nodes. Graphs are put into a canonical form (so every
+ * labelling of the same rooted graph gets the same key) with colour refinement
+ * plus a search over the ways to break ties, like nauty does, minus most of
+ * nauty's cleverness. Ties between twins (nodes with the same neighbors) are
+ * only ever broken one way, since swapping twins doesn't change anything
+ * - Highly symmetric graphs can still make the search blow up, so it gives up
+ * after TB_CANON_MAX_LEAVES labellings. Graphs it gives up on aren't in the
+ * table, and positions that reduce to them just get searched as usual
+ *
+ * File layout (native byte order):
+ *	TB_HEADER, then num_entries TB_KEYs sorted by tb_key_less with each
+ *	entry's results in the top bits of hi (TB_MAC_WIN/ TB_AAC_WIN)
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <unordered_set>
+#include <vector>
+
+#include "Adjacency_Matrix.h"
+#include "Transposition_Table.h"
+
+// Most nodes/ edges a residual graph in the table can have. Keys have room
+// for the adjacency of TB_MAX_NODES nodes, and a connected graph on that many
+// nodes has at least TB_MAX_NODES - 1 edges
+#define TB_MAX_NODES 16
+#define TB_MAX_EDGES 15
+// Size of the table generated when the caller doesn't ask for something else
+#define TB_DEFAULT_EDGES 12
+// Labellings the canonical form search tries before giving up on a graph
+#define TB_CANON_MAX_LEAVES 64
+// First 8 bytes of a tablebase file
+#define TB_MAGIC "CYCTB001"
+
+// Where things live in a key's hi word: the adjacency bits run up to bit 55,
+// the number of nodes minus 1 sits above them, and the results on top
+#define TB_NODES_SHIFT 56
+#define TB_MAC_WIN ((uint64_t)1 << 60)
+#define TB_AAC_WIN ((uint64_t)1 << 61)
+#define TB_RESULT_BITS (TB_MAC_WIN | TB_AAC_WIN)
+
+// A rooted graph small enough for the table, node 0 is the root
+typedef struct SMALL_GRAPH {
+    uint_fast8_t num_nodes = 1;
+    uint16_t adj[TB_MAX_NODES] = {}; // neighbors of each node, as a bit mask
+} SMALL_GRAPH;
+
+// A rooted graph's canonical adjacency (the pair of nodes i < j is bit
+// j * (j - 1) / 2 + i, low word first) plus its number of nodes
+typedef struct TB_KEY {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    bool operator==(const TB_KEY &other) const {
+        return lo == other.lo && hi == other.hi;
+    }
+} TB_KEY;
+
+typedef struct TB_HEADER {
+    char magic[8];
+    uint32_t max_edges;  // every rooted graph with up to this many edges
+    uint32_t given_up;   // graphs left out because canonizing them gave up
+    uint64_t num_entries;
+} TB_HEADER;
+
+// A loaded tablebase. The entries point into the mapped file (see map_file),
+// which stays mapped as long as the tablebase holds on to it
+typedef struct TABLEBASE {
+    const TB_KEY *entries = NULL;
+    uint64_t num_entries = 0;
+    uint32_t max_edges = 0;
+    std::shared_ptr<MAPPED_FILE> file;
+} TABLEBASE;
+
+/****************************************************************************
+ * tb_key_less
+ *
+ * - Lil helper function, the order tablebase entries are sorted in, ignoring
+ * any result bits
+ ****************************************************************************/
+inline bool tb_key_less(const TB_KEY &__restrict left,
+                        const TB_KEY &__restrict right) {
+    const uint64_t left_hi = left.hi & ~TB_RESULT_BITS;
+    const uint64_t right_hi = right.hi & ~TB_RESULT_BITS;
+    return left_hi != right_hi ? left_hi < right_hi : left.lo < right.lo;
+}
+
+// Random weights for colour refinement's neighbor colour multisets, one per
+// colour
+inline const std::array<uint64_t, TB_MAX_NODES> TB_COLOR_WEIGHTS = []() {
+    std::array<uint64_t, TB_MAX_NODES> weights = {};
+    uint64_t state = ZOBRIST_SEED;
+    for (uint64_t &weight : weights) {
+        weight = splitmix64(&state);
+    }
+    return weights;
+}();
+
+/****************************************************************************
+ * refine_colors
+ *
+ * - Colour refinement: keeps splitting up the nodes of each colour by which
+ * colours their neighbors have, until nothing splits any more
+ * - Colours are ranks (0 up to the number of colours, minus 1), and a node's
+ * new rank only depends on its old rank and its neighbors' ranks, so the
+ * result doesn't depend on how the graph's nodes are labelled
+ * - The neighbors' colours are boiled down to a sum of per colour weights.
+ * Two different sums colliding would only leave the colouring coarser than it
+ * could be (more ties for canon_search to break), it's still the same for
+ * every labelling
+ *
+ * Parameters :
+ * - graph : the graph
+ * - colors : each node's colour, refined in place
+ *
+ * Returns :
+ * - uint_fast8_t : the number of colours
+ ****************************************************************************/
+uint_fast8_t refine_colors(const SMALL_GRAPH &__restrict graph,
+                           uint8_t *__restrict colors) {
+    const uint_fast8_t num_nodes = graph.num_nodes;
+    uint_fast8_t num_colors = 0;
+    for (uint_fast8_t node = 0; node < num_nodes; node++) {
+        num_colors = std::max<uint_fast8_t>(num_colors, colors[node] + 1);
+    }
+
+    while (num_colors < num_nodes) {
+        // signature: own colour on top, the neighbors' colours below it.
+        // Insertion sorted along the way, there are only a handful of nodes
+        uint64_t signatures[TB_MAX_NODES];
+        uint8_t order[TB_MAX_NODES];
+        for (uint_fast8_t node = 0; node < num_nodes; node++) {
+            uint64_t neighbor_sum = 0;
+            for (uint16_t bits = graph.adj[node]; bits != 0;
+                 bits &= bits - 1) {
+                neighbor_sum +=
+                    TB_COLOR_WEIGHTS[colors[std::countr_zero(bits)]];
+            }
+            const uint64_t signature =
+                ((uint64_t)colors[node] << 59) | (neighbor_sum >> 5);
+            uint_fast8_t slot = node;
+            while (slot > 0 && signatures[slot - 1] > signature) {
+                signatures[slot] = signatures[slot - 1];
+                order[slot] = order[slot - 1];
+                slot--;
+            }
+            signatures[slot] = signature;
+            order[slot] = (uint8_t)node;
+        }
+
+        uint_fast8_t new_colors = 0;
+        for (uint_fast8_t index = 0; index < num_nodes; index++) {
+            if (index > 0 && signatures[index - 1] != signatures[index]) {
+                new_colors++;
+            }
+            colors[order[index]] = (uint8_t)new_colors;
+        }
+        new_colors++;
+        if (new_colors == num_colors) {
+            break;
+        }
+        num_colors = new_colors;
+    }
+
+    return num_colors;
+}
+
+/****************************************************************************
+ * canon_search
+ *
+ * - Lil helper function for canonical_small_graph, refines the colouring and
+ * then either reads a key off of it (every node has its own colour) or tries
+ * each way of breaking the first tie, keeping the smallest key seen
+ *
+ * Parameters :
+ * - graph : the graph
+ * - start_colors : the colouring to start from (a copy is refined)
+ * - best_out : the smallest key seen so far
+ * - have_best : whether best_out holds anything yet
+ * - leaves : the number of keys read off so far
+ *
+ * Returns :
+ * - bool : false if the search gave up
+ ****************************************************************************/
+bool canon_search(const SMALL_GRAPH &__restrict graph,
+                  const uint8_t *__restrict start_colors,
+                  TB_KEY *__restrict best_out, bool *__restrict have_best,
+                  uint32_t *__restrict leaves) {
+    const uint_fast8_t num_nodes = graph.num_nodes;
+    uint8_t colors[TB_MAX_NODES];
+    std::memcpy(colors, start_colors, num_nodes);
+    const uint_fast8_t num_colors = refine_colors(graph, colors);
+
+    if (num_colors == num_nodes) {
+        if (++(*leaves) > TB_CANON_MAX_LEAVES) {
+            return false;
+        }
+        TB_KEY key;
+        for (uint_fast8_t node = 0; node < num_nodes; node++) {
+            for (uint16_t bits = graph.adj[node] & ((1U << node) - 1);
+                 bits != 0; bits &= bits - 1) {
+                const uint_fast8_t low =
+                    std::min(colors[node], colors[std::countr_zero(bits)]);
+                const uint_fast8_t high =
+                    std::max(colors[node], colors[std::countr_zero(bits)]);
+                const uint_fast8_t pair = high * (high - 1) / 2 + low;
+                if (pair < 64) {
+                    key.lo |= (uint64_t)1 << pair;
+                } else {
+                    key.hi |= (uint64_t)1 << (pair - 64);
+                }
+            }
+        }
+        key.hi |= (uint64_t)(num_nodes - 1) << TB_NODES_SHIFT;
+        if (!*have_best || tb_key_less(key, *best_out)) {
+            *best_out = key;
+            *have_best = true;
+        }
+        return true;
+    }
+
+    // break a tie in the first colour that has one
+    uint16_t cell_size[TB_MAX_NODES] = {};
+    for (uint_fast8_t node = 0; node < num_nodes; node++) {
+        cell_size[colors[node]]++;
+    }
+    uint_fast8_t target = 0;
+    while (cell_size[target] < 2) {
+        target++;
+    }
+
+    uint16_t tried = 0; // nodes of the cell already split off
+    for (uint_fast8_t node = 0; node < num_nodes; node++) {
+        if (colors[node] != target) {
+            continue;
+        }
+        bool twin_tried = false;
+        for (uint16_t bits = tried; bits != 0 && !twin_tried;
+             bits &= bits - 1) {
+            const uint_fast8_t other = std::countr_zero(bits);
+            twin_tried = (graph.adj[node] & ~(1U << other)) ==
+                         (graph.adj[other] & ~(1U << node));
+        }
+        if (twin_tried) { // swapping twins changes nothing
+            continue;
+        }
+        tried |= (uint16_t)(1U << node);
+
+        // node keeps the colour, the rest of its cell moves up one, and
+        // everything above the cell moves up one to make room
+        uint8_t split[TB_MAX_NODES];
+        for (uint_fast8_t other = 0; other < num_nodes; other++) {
+            split[other] = colors[other] +
+                           (colors[other] > target ||
+                                    (colors[other] == target && other != node)
+                                ? 1
+                                : 0);
+        }
+        if (!canon_search(graph, split, best_out, have_best, leaves)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/****************************************************************************
+ * canonical_small_graph
+ *
+ * - Works out a rooted graph's key: the same for every labelling of the same
+ * rooted graph (the root always stays node 0), different for different ones
+ *
+ * Parameters :
+ * - graph : the graph
+ * - key_out : where the key is written
+ *
+ * Returns :
+ * - bool : false if the graph was too symmetric to canonize cheaply
+ ****************************************************************************/
+bool canonical_small_graph(const SMALL_GRAPH &__restrict graph,
+                           TB_KEY *__restrict key_out) {
+    uint8_t colors[TB_MAX_NODES];
+    colors[0] = 0;
+    for (uint_fast8_t node = 1; node < graph.num_nodes; node++) {
+        colors[node] = 1;
+    }
+    bool have_best = false;
+    uint32_t leaves = 0;
+    *key_out = TB_KEY{};
+    return canon_search(graph, colors, key_out, &have_best, &leaves);
+}
+
+/****************************************************************************
+ * small_graph_from_key
+ *
+ * - Lil helper function, rebuilds the (canonically labelled) graph a key
+ * describes
+ ****************************************************************************/
+SMALL_GRAPH small_graph_from_key(const TB_KEY &__restrict key) {
+    SMALL_GRAPH graph;
+    graph.num_nodes =
+        (uint_fast8_t)(((key.hi >> TB_NODES_SHIFT) & 0xF) + 1);
+    uint_fast8_t pair = 0;
+    for (uint_fast8_t high = 1; high < graph.num_nodes; high++) {
+        for (uint_fast8_t low = 0; low < high; low++, pair++) {
+            const uint64_t word = pair < 64 ? key.lo : key.hi;
+            if ((word >> (pair & 63)) & 1) {
+                graph.adj[low] |= (uint16_t)(1U << high);
+                graph.adj[high] |= (uint16_t)(1U << low);
+            }
+        }
+    }
+    return graph;
+}
+
+/****************************************************************************
+ * small_MAC_wins/ small_AAC_wins
+ *
+ * - Plays MAC/ AAC on a small graph by brute force, for filling in the table
+ *
+ * Parameters :
+ * - graph : the graph
+ * - curr_node : the current node
+ * - prev_node : (MAC) the node the game just came from, or TB_MAX_NODES at
+ * the start
+ * - visited : the visited nodes, as a bit mask
+ *
+ * Returns :
+ * - bool : true if the player to move from curr_node wins
+ ****************************************************************************/
+bool small_MAC_wins(const SMALL_GRAPH &__restrict graph,
+                    const uint_fast8_t curr_node, const uint_fast8_t prev_node,
+                    const uint16_t visited) {
+    const uint16_t open =
+        graph.adj[curr_node] &
+        (uint16_t)~(prev_node < TB_MAX_NODES ? 1U << prev_node : 0);
+    if ((open & visited) != 0) { // going back creates a cycle!
+        return true;
+    }
+    for (uint16_t bits = open; bits != 0; bits &= bits - 1) {
+        const uint_fast8_t next = std::countr_zero(bits);
+        if (!small_MAC_wins(graph, next, curr_node,
+                            visited | (uint16_t)(1U << next))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool small_AAC_wins(const SMALL_GRAPH &__restrict graph,
+                    const uint_fast8_t curr_node, const uint16_t visited) {
+    for (uint16_t bits = graph.adj[curr_node] & (uint16_t)~visited; bits != 0;
+         bits &= bits - 1) {
+        const uint_fast8_t next = std::countr_zero(bits);
+        if (!small_AAC_wins(graph, next, visited | (uint16_t)(1U << next))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// hashing for the generator's sets of keys
+struct TB_KEY_HASH {
+    size_t operator()(const TB_KEY &key) const {
+        uint64_t state = key.lo ^ (key.hi * 0x9E3779B97F4A7C15ULL);
+        return (size_t)splitmix64(&state);
+    }
+};
+
+/****************************************************************************
+ * make_tablebase
+ *
+ * - Works out both games' results on every rooted connected graph with up to
+ * max_edges edges, and writes them to a tablebase file
+ * - The graphs are found a layer at a time: every graph with e + 1 edges comes
+ * from one with e edges, either by joining two of its nodes or by hanging a
+ * new node off of one (take away an edge on a cycle, or the edge to a leaf
+ * that isn't the root, and what's left is still connected)
+ *
+ * Parameters :
+ * - path : the file to write
+ * - max_edges : the biggest graphs to include, in edges (at most
+ * TB_MAX_EDGES)
+ *
+ * Returns :
+ * - bool : false if the file couldn't be written
+ ****************************************************************************/
+bool make_tablebase(const char *__restrict path, const uint32_t max_edges) {
+    std::vector<TB_KEY> entries;
+    std::vector<TB_KEY> layer = {TB_KEY{}}; // just the root
+    uint32_t given_up = 0;
+
+    for (uint32_t num_edges = 0; num_edges <= max_edges; num_edges++) {
+        std::unordered_set<TB_KEY, TB_KEY_HASH> next_layer;
+        for (const TB_KEY &key : layer) {
+            const SMALL_GRAPH graph = small_graph_from_key(key);
+            TB_KEY entry = key;
+            entry.hi |= small_MAC_wins(graph, 0, TB_MAX_NODES, 1) ? TB_MAC_WIN
+                                                                  : 0;
+            entry.hi |= small_AAC_wins(graph, 0, 1) ? TB_AAC_WIN : 0;
+            entries.push_back(entry);
+            if (num_edges == max_edges) {
+                continue;
+            }
+
+            auto add_grown = [&next_layer, &given_up](const SMALL_GRAPH &grown) {
+                TB_KEY grown_key;
+                if (canonical_small_graph(grown, &grown_key)) {
+                    next_layer.insert(grown_key);
+                } else {
+                    given_up++;
+                }
+            };
+            for (uint_fast8_t high = 1; high < graph.num_nodes; high++) {
+                for (uint_fast8_t low = 0; low < high; low++) {
+                    if ((graph.adj[low] >> high) & 1) {
+                        continue;
+                    }
+                    SMALL_GRAPH grown = graph;
+                    grown.adj[low] |= (uint16_t)(1U << high);
+                    grown.adj[high] |= (uint16_t)(1U << low);
+                    add_grown(grown);
+                }
+            }
+            if (graph.num_nodes < TB_MAX_NODES) {
+                for (uint_fast8_t node = 0; node < graph.num_nodes; node++) {
+                    SMALL_GRAPH grown = graph;
+                    grown.adj[node] |= (uint16_t)(1U << graph.num_nodes);
+                    grown.adj[graph.num_nodes] = (uint16_t)(1U << node);
+                    grown.num_nodes++;
+                    add_grown(grown);
+                }
+            }
+        }
+        fprintf(stderr, "Tablebase: %zu rooted graphs with %u edges\n",
+                layer.size(), num_edges);
+        layer.assign(next_layer.begin(), next_layer.end());
+    }
+    std::sort(entries.begin(), entries.end(), tb_key_less);
+
+    TB_HEADER header = {};
+    std::memcpy(header.magic, TB_MAGIC, sizeof(header.magic));
+    header.max_edges = max_edges;
+    header.given_up = given_up;
+    header.num_entries = entries.size();
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output.write((const char *)&header, sizeof(header));
+    output.write((const char *)entries.data(),
+                 (std::streamsize)(entries.size() * sizeof(TB_KEY)));
+    return (bool)output;
+}
+
+/****************************************************************************
+ * close_tablebase
+ *
+ * - Unmaps/ frees a loaded tablebase
+ ****************************************************************************/
+void close_tablebase(TABLEBASE *__restrict tablebase) {
+    *tablebase = TABLEBASE{}; // the file gets unmapped along with it
+}
+
+/****************************************************************************
+ * load_tablebase
+ *
+ * - Maps a tablebase file into memory (see map_file)
+ * - Pages of the table only get read in from disk as lookups touch them, and
+ * several processes using the same file share the one copy
+ *
+ * Parameters :
+ * - path : the tablebase file
+ * - tablebase : where the loaded table goes, release it with
+ * close_tablebase when done
+ *
+ * Returns :
+ * - bool : false if the file couldn't be read or isn't a tablebase
+ ****************************************************************************/
+bool load_tablebase(const char *__restrict path,
+                    TABLEBASE *__restrict tablebase) {
+    *tablebase = TABLEBASE{};
+    auto file = std::make_shared<MAPPED_FILE>();
+    if (!map_file(std::filesystem::path(path), file.get()) ||
+        file->size < sizeof(TB_HEADER)) {
+        return false;
+    }
+    const char *const data = file->data;
+    const size_t size = file->size;
+    tablebase->file = std::move(file);
+
+    TB_HEADER header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, TB_MAGIC, sizeof(header.magic)) != 0 ||
+        header.max_edges > TB_MAX_EDGES ||
+        header.num_entries > (size - sizeof(header)) / sizeof(TB_KEY)) {
+        close_tablebase(tablebase);
+        return false;
+    }
+    tablebase->entries = (const TB_KEY *)(data + sizeof(header));
+    tablebase->num_entries = header.num_entries;
+    tablebase->max_edges = header.max_edges;
+    return true;
+}
+
+/****************************************************************************
+ * tb_lookup
+ *
+ * - Looks a residual graph up in the table
+ *
+ * Parameters :
+ * - tablebase : the loaded table
+ * - graph : the residual graph
+ * - MAC : true for MAC's result, false for AAC's
+ *
+ * Returns :
+ * - TT_RESULT : the result for the player moving from the root, or EMPTY if
+ * the graph isn't in the table
+ ****************************************************************************/
+TT_RESULT tb_lookup(const TABLEBASE &__restrict tablebase,
+                    const SMALL_GRAPH &__restrict graph, const bool MAC) {
+    TB_KEY key;
+    if (!canonical_small_graph(graph, &key)) {
+        return TT_RESULT::EMPTY;
+    }
+    const TB_KEY *end = tablebase.entries + tablebase.num_entries;
+    const TB_KEY *found =
+        std::lower_bound(tablebase.entries, end, key, tb_key_less);
+    if (found == end || tb_key_less(key, *found)) {
+        return TT_RESULT::EMPTY;
+    }
+    return (found->hi & (MAC ? TB_MAC_WIN : TB_AAC_WIN)) != 0
+               ? TT_RESULT::WIN
+               : TT_RESULT::LOSS;
+}
@@ -1,57 +1,171 @@
 #pragma once
-// https://github.com/PaulRitaldato1/ThreadPool/tree/master
+/*
+ *
+ * - A fixed size thread pool with work stealing
+ * - Every thread has its own deque of jobs. A thread works off the back of its
+ * own deque (most recently queued first), and when that's empty steals from
+ * the front of the others' (oldest first). Jobs queued from one of the pool's
+ * own threads go on that thread's deque; jobs queued from outside are dealt
+ * out round robin
+ * - The deques are bounded: if the one a job would go on already holds
+ * POOL_QUEUE_CAPACITY jobs, the job is run right away on the queueing thread
+ * instead, which keeps a runaway producer from eating all the memory
+ * - Jobs own copies of (or have moved in) their function and arguments, so
+ * it's fine for the caller's frame to be long gone by the time they run.
+ * Wrap an argument in std::ref to deliberately pass it by reference
+ * - Threads with nothing to do sleep on a condition variable rather than
+ * spinning
+ *
+ */
+
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <stop_token>
 #include <thread>
 #include <type_traits>
-#include <typeinfo>
+#include <utility>
 #include <vector>
 
+// Most jobs a single thread's deque can hold before new ones get run inline
+#define POOL_QUEUE_CAPACITY 4096
+
 /* ThreadPool class */
 class ThreadPool {
   public:
-    ThreadPool() {
-        m_shutdown.store(false, std::memory_order_relaxed);
-        createThreads(1);
-    }
+    // one thread per hardware thread
+    ThreadPool() : ThreadPool(0) {}
 
-    ThreadPool(std::size_t numThreads) {
-        m_shutdown.store(false, std::memory_order_relaxed);
+    // numThreads == 0 means one thread per hardware thread
+    explicit ThreadPool(std::size_t numThreads) {
+        if (numThreads == 0) {
+            numThreads =
+                std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        m_queues.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; i++) {
+            m_queues.push_back(std::make_unique<WorkQueue>());
+        }
         createThreads(numThreads);
     }
 
-    ~ThreadPool() {
-        m_shutdown.store(true, std::memory_order_relaxed);
-        m_notifier.notify_all();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
 
-        for (std::jthread &th : m_threads) {
-            th.join();
+    // jobs that are still queued get run before the threads exit
+    ~ThreadPool() {
+        {
+            std::scoped_lock<std::mutex> lock(m_sleepMutex);
+            m_shutdown.store(true);
         }
+        m_sleepNotifier.notify_all();
+        m_threads.clear(); // joins
     }
 
-    // add any arg # function to queue
+    // queue up f(args...), returning a future for its result
     template <typename Func, typename... Args>
     auto enqueue(Func &&f, Args &&...args) {
-        // get return type of the function
-        using RetType = std::invoke_result_t<Func, Args...>;
+        using RetType = std::invoke_result_t<std::decay_t<Func>,
+                                             std::decay_t<Args> &...>;
 
         auto task = std::make_shared<std::packaged_task<RetType()>>(
-            [&f, &args...]() { return f(std::forward<Args>(args)...); });
+            [f = std::forward<Func>(f),
+             ... args = std::forward<Args>(args)]() mutable {
+                return std::invoke(f, args...);
+            });
+        std::future<RetType> result = task->get_future();
+        push([task]() { (*task)(); });
 
-        {
-            // lock jobQueue mutex, add job to the job queue
-            std::scoped_lock<std::mutex> lock(m_jobMutex);
+        return result;
+    }
 
-            // place the job into the queue
-            m_jobQueue.emplace([task]() { (*task)(); });
+    /*
+     * - Runs every task on the pool, and blocks until the first one whose
+     * result satisfies isWin comes back. The rest are then asked to stop
+     * through the std::stop_token they're passed, and waited on, so that
+     * they're all finished (and done touching anything of the caller's) by the
+     * time this returns
+     * - Returns the winning result, or nothing if no task won
+     * - If any task threw, the first exception is rethrown here once every
+     * task is finished
+     * - When called from one of the pool's own threads, that thread runs queued
+     * jobs while it waits rather than tying up the pool
+     */
+    template <typename T, typename IsWin>
+    std::optional<T>
+    when_any(std::vector<std::function<T(std::stop_token)>> tasks,
+             IsWin isWin) {
+        struct Completion {
+            std::mutex mutex;
+            std::condition_variable notifier;
+            std::size_t remaining = 0;
+            std::optional<T> winner;
+            std::exception_ptr error;
+            std::stop_source stop;
+        };
+        auto completion = std::make_shared<Completion>();
+        completion->remaining = tasks.size();
+
+        for (std::function<T(std::stop_token)> &task : tasks) {
+            push([completion, isWin, task = std::move(task)]() {
+                std::optional<T> value;
+                std::exception_ptr error;
+                try {
+                    value.emplace(task(completion->stop.get_token()));
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                std::scoped_lock<std::mutex> lock(completion->mutex);
+                if (error != nullptr && completion->error == nullptr) {
+                    completion->error = error;
+                    completion->stop.request_stop();
+                } else if (value.has_value() && !completion->winner &&
+                           isWin(*value)) {
+                    completion->winner = std::move(value);
+                    completion->stop.request_stop();
+                }
+                if (--completion->remaining == 0) {
+                    completion->notifier.notify_all();
+                }
+            });
+        }
+
+        auto finished = [&completion]() {
+            return completion->remaining == 0;
+        };
+        if (t_pool == this) { // lend a hand instead of blocking the thread
+            while (true) {
+                {
+                    std::scoped_lock<std::mutex> lock(completion->mutex);
+                    if (finished()) {
+                        break;
+                    }
+                }
+                if (!tryRunOne(t_index)) {
+                    // anything left is running on another thread
+                    std::unique_lock<std::mutex> lock(completion->mutex);
+                    completion->notifier.wait(lock, finished);
+                    break;
+                }
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(completion->mutex);
+            completion->notifier.wait(lock, finished);
         }
-        m_notifier.notify_one();
 
-        return task->get_future();
+        if (completion->error != nullptr) {
+            std::rethrow_exception(completion->error);
+        }
+        return std::move(completion->winner);
     }
 
     /* utility functions */
@@ -59,34 +173,96 @@ class ThreadPool {
 
   private:
     using Job = std::function<void()>;
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
     std::vector<std::jthread> m_threads;
-    std::queue<Job> m_jobQueue;
-    std::condition_variable m_notifier;
-    std::mutex m_jobMutex;
-    std::atomic<bool> m_shutdown;
+    std::atomic<std::size_t> m_pending = 0;  // jobs sitting in the deques
+    std::atomic<std::size_t> m_sleeping = 0; // threads waiting for jobs
+    std::atomic<std::size_t> m_nextQueue = 0; // round robin for outsiders
+    std::atomic<bool> m_shutdown = false;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepNotifier;
 
-    void createThreads(std::size_t numThreads) {
-        m_threads.reserve(numThreads);
-        for (int i = 0; i != numThreads; ++i) {
-            m_threads.emplace_back(std::jthread([this]() {
-                while (true) {
-                    Job job;
-                    {
-                        std::unique_lock<std::mutex> lock(m_jobMutex);
-                        m_notifier.wait(lock, [this] {
-                            return !m_jobQueue.empty() ||
-                                   m_shutdown.load(std::memory_order_relaxed);
-                        });
+    // which pool (if any) the current thread belongs to, and its index there
+    static inline thread_local ThreadPool *t_pool = nullptr;
+    static inline thread_local std::size_t t_index = 0;
 
-                        if (m_shutdown.load(std::memory_order_relaxed)) {
-                            break;
-                        }
+    void push(Job job) {
+        const std::size_t index =
+            t_pool == this ? t_index
+                           : m_nextQueue.fetch_add(1) % m_queues.size();
+        WorkQueue &queue = *m_queues[index];
+        {
+            std::scoped_lock<std::mutex> lock(queue.mutex);
+            if (queue.jobs.size() < POOL_QUEUE_CAPACITY) {
+                queue.jobs.push_back(std::move(job));
+                job = nullptr;
+                m_pending.fetch_add(1);
+            }
+        }
+        if (job) { // deque's full, run it here
+            job();
+            return;
+        }
 
-                        job = std::move(m_jobQueue.front());
+        // counted before checking for sleepers, and sleepers are counted
+        // before they check for jobs, so one of the two always notices
+        if (m_sleeping.load() > 0) {
+            { std::scoped_lock<std::mutex> lock(m_sleepMutex); }
+            m_sleepNotifier.notify_one();
+        }
+    }
+
+    // takes a job from the back of deque self, or else from the front of one
+    // of the others, and runs it
+    bool tryRunOne(const std::size_t self) {
+        Job job;
+        for (std::size_t offset = 0; offset < m_queues.size() && !job;
+             offset++) {
+            WorkQueue &queue = *m_queues[(self + offset) % m_queues.size()];
+            std::scoped_lock<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            } else {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+            m_pending.fetch_sub(1);
+        }
+        if (!job) {
+            return false;
+        }
+        job();
+        return true;
+    }
 
-                        m_jobQueue.pop();
+    void createThreads(std::size_t numThreads) {
+        m_threads.reserve(numThreads);
+        for (std::size_t i = 0; i != numThreads; ++i) {
+            m_threads.emplace_back(std::jthread([this, i]() {
+                t_pool = this;
+                t_index = i;
+                while (true) {
+                    if (tryRunOne(i)) {
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> lock(m_sleepMutex);
+                    m_sleeping.fetch_add(1);
+                    m_sleepNotifier.wait(lock, [this] {
+                        return m_pending.load() > 0 || m_shutdown.load();
+                    });
+                    m_sleeping.fetch_sub(1);
+                    if (m_pending.load() == 0 && m_shutdown.load()) {
+                        break;
                     }
-                    job();
                 }
             }));
         }
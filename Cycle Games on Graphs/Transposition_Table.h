@@ -0,0 +1,364 @@
+#pragma once
+/*
+ *
+ * - This file holds the transposition table used by the quiet game playing
+ * code to avoid re-solving positions that it has already seen
+ * - A position in either game is the current node plus the set of used edges,
+ * but for a fixed starting node the used edges always form a single path, so
+ * keying on them would never find a transposition. What actually matters for
+ * the rest of the game is less than that:
+ *	- in AAC we can only ever move to unvisited nodes, so the current node and
+ *	the set of visited nodes completely determine the outcome
+ *	- in MAC the same is true once the "is there an unused edge back to a
+ *	visited node?" check has failed, since at that point the only used edge
+ *	touching the current node is the one we just came in along
+ * - So the table is keyed on (current node, visited node set). Two different
+ * move orders that visit the same nodes and end up on the same node are the
+ * same position, and since the key doesn't mention the starting node, results
+ * stay valid across games started from different nodes
+ * - Positions are hashed with Zobrist hashing: every node gets two random 64
+ * bit keys, one for being visited and one for being the current node, and a
+ * position's hash is the XOR of the keys of its visited nodes and its current
+ * node. Making or undoing a move is then just three XORs, which is done in the
+ * game code right next to where the node use list is set
+ * - A 64 bit hash can still collide, so every entry also keeps a copy of the
+ * full position (current node + packed node use list) that gets checked before
+ * a result is trusted
+ *
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Packed_State.h"
+
+// Default size used when the caller doesn't ask for something specific
+#define TT_DEFAULT_SIZE_MB 64
+
+// Arbitrary fixed seed so that runs are reproducible
+#define ZOBRIST_SEED 0x9E3779B97F4A7C15ULL
+
+// Results as stored in the table, kept separate from GAME_STATE so this file
+// doesn't have to know about the game code
+enum class TT_RESULT : uint8_t { EMPTY, WIN, LOSS };
+
+/****************************************************************************
+ * splitmix64
+ *
+ * - Small, fast pseudo random number generator used to fill in the Zobrist
+ * keys
+ * - https://prng.di.unimi.it/splitmix64.c
+ *
+ * Parameters :
+ * - state : the generator's state, advanced by the call
+ *
+ * Returns :
+ * - uint64_t : the next pseudo random value
+ ****************************************************************************/
+inline uint64_t splitmix64(uint64_t *__restrict state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Random keys for each node of a graph
+typedef struct ZOBRIST_KEYS {
+    std::vector<uint64_t> visited_keys; // XORed in while a node is visited
+    std::vector<uint64_t> current_keys; // XORed in while a node is current
+} ZOBRIST_KEYS;
+
+/****************************************************************************
+ * zobrist_init
+ *
+ * - Fills in a set of Zobrist keys for a graph of the given size
+ *
+ * Parameters :
+ * - num_nodes : the number of nodes in the graph
+ *
+ * Returns :
+ * - ZOBRIST_KEYS : the generated keys
+ ****************************************************************************/
+ZOBRIST_KEYS zobrist_init(const size_t num_nodes) {
+    ZOBRIST_KEYS keys;
+    uint64_t rng_state = ZOBRIST_SEED;
+
+    keys.visited_keys.resize(num_nodes);
+    for (uint64_t &key : keys.visited_keys) {
+        key = splitmix64(&rng_state);
+    }
+    keys.current_keys.resize(num_nodes);
+    for (uint64_t &key : keys.current_keys) {
+        key = splitmix64(&rng_state);
+    }
+
+    return keys;
+}
+
+/****************************************************************************
+ * zobrist_move_key
+ *
+ * - Gives the value to XOR into a position's hash when making (or undoing) a
+ * move from one node to a previously unvisited node
+ *
+ * Parameters :
+ * - keys : the graph's Zobrist keys
+ * - from_node : the node the move starts at
+ * - to_node : the node the move ends at
+ *
+ * Returns :
+ * - uint64_t : the value to XOR into the hash
+ ****************************************************************************/
+inline uint64_t zobrist_move_key(const ZOBRIST_KEYS &__restrict keys,
+                                 const size_t from_node, const size_t to_node) {
+    return keys.visited_keys[to_node] ^ keys.current_keys[from_node] ^
+           keys.current_keys[to_node];
+}
+
+/****************************************************************************
+ * zobrist_start_key
+ *
+ * - Gives the hash of the position at the start of a game, where only the
+ * starting node has been visited
+ *
+ * Parameters :
+ * - keys : the graph's Zobrist keys
+ * - start_node : the node the game starts on
+ *
+ * Returns :
+ * - uint64_t : the starting position's hash
+ ****************************************************************************/
+inline uint64_t zobrist_start_key(const ZOBRIST_KEYS &__restrict keys,
+                                  const size_t start_node) {
+    return keys.visited_keys[start_node] ^ keys.current_keys[start_node];
+}
+
+/*
+ *
+ * - The table is made up of buckets of TT_BUCKET_SIZE entries
+ * - Replacement policy within a bucket:
+ *	- the first slot is "work preferred": it holds whichever result took the
+ *	most search work (positions visited) to find, since those are the most
+ *	expensive to lose
+ *	- the second slot is "always replace": anything that doesn't beat the first
+ *	slot goes here, and when the first slot gets taken over its old entry is
+ *	moved down here
+ * - Each entry's full key lives in a separate array (key_words), words_per_key
+ * 64 bit words per entry, so the entries themselves stay small
+ *
+ */
+#define TT_BUCKET_SIZE 2
+static_assert(TT_BUCKET_SIZE == 2,
+              "The replacement policy assumes two entries per bucket!");
+
+typedef struct TT_ENTRY {
+    uint64_t hash = 0;
+    uint32_t work = 0; // positions visited to find the result, saturating
+    uint32_t curr_node = 0;
+    TT_RESULT result = TT_RESULT::EMPTY;
+} TT_ENTRY;
+
+typedef struct TT_STATS {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t collisions = 0; // hash matched, but the full key didn't
+    uint64_t stores = 0;
+    uint64_t overwrites = 0; // stores that pushed out another position
+} TT_STATS;
+
+typedef struct TRANSPOSITION_TABLE {
+    std::vector<TT_ENTRY> entries;
+    std::vector<uint64_t> key_words;
+    size_t words_per_key = 0;
+    size_t bucket_mask = 0; // number of buckets - 1 (always a power of 2)
+    uint32_t min_store_work = 1;
+    TT_STATS stats;
+} TRANSPOSITION_TABLE;
+
+/****************************************************************************
+ * tt_init
+ *
+ * - Allocates a transposition table that fits in (roughly) the requested
+ * amount of memory, for positions on a graph with the given number of nodes
+ * - The number of buckets is rounded down to a power of 2 so that a hash can
+ * be turned into a bucket with a mask
+ *
+ * Parameters :
+ * - table : the table to set up. Any previous contents are thrown out
+ * - size_mb : the memory budget for the table, in megabytes
+ * - num_nodes : the number of nodes in the graph being played on
+ *
+ * Returns :
+ * - bool : true if a table with at least one bucket was allocated
+ ****************************************************************************/
+bool tt_init(TRANSPOSITION_TABLE *__restrict table, const size_t size_mb,
+             const size_t num_nodes) {
+    *table = TRANSPOSITION_TABLE{};
+    table->words_per_key = (num_nodes + 63) / 64;
+
+    const size_t bucket_bytes =
+        TT_BUCKET_SIZE * (sizeof(TT_ENTRY) + table->words_per_key * 8);
+    size_t num_buckets = (size_mb * 1024 * 1024) / bucket_bytes;
+    if (num_buckets == 0) {
+        return false;
+    }
+    size_t pow_2 = 1;
+    while (pow_2 * 2 <= num_buckets) {
+        pow_2 *= 2;
+    }
+    num_buckets = pow_2;
+
+    table->entries.resize(num_buckets * TT_BUCKET_SIZE);
+    table->key_words.resize(num_buckets * TT_BUCKET_SIZE *
+                            table->words_per_key);
+    table->bucket_mask = num_buckets - 1;
+    // storing a position copies its full key, which isn't worth it for tiny
+    // subtrees on graphs with a lot of nodes
+    table->min_store_work = (uint32_t)(1 + table->words_per_key / 16);
+
+    return true;
+}
+
+/****************************************************************************
+ * tt_clear
+ *
+ * - Empties out a table without giving up its memory, e.g. before switching
+ * to a different game on the same graph
+ *
+ * Parameters :
+ * - table : the table to clear
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void tt_clear(TRANSPOSITION_TABLE *__restrict table) {
+    std::fill(table->entries.begin(), table->entries.end(), TT_ENTRY{});
+    table->stats = TT_STATS{};
+}
+
+/****************************************************************************
+ * tt_key_matches
+ *
+ * - Helper function, checks an entry's full key against a position
+ *
+ * Parameters :
+ * - table : the table holding the entry
+ * - slot : the entry's index in the table
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ *
+ * Returns :
+ * - bool : whether the entry holds the given position
+ ****************************************************************************/
+inline bool tt_key_matches(const TRANSPOSITION_TABLE &__restrict table,
+                           const size_t slot, const uint32_t curr_node,
+                           const uint64_t *__restrict node_words) {
+    return table.entries[slot].curr_node == curr_node &&
+           std::memcmp(&table.key_words[slot * table.words_per_key],
+                       node_words, table.words_per_key * 8) == 0;
+}
+
+/****************************************************************************
+ * tt_probe
+ *
+ * - Looks up a position in the table
+ *
+ * Parameters :
+ * - table : the table to look in
+ * - hash : the position's Zobrist hash
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ *
+ * Returns :
+ * - TT_RESULT : the stored result, or EMPTY if the position isn't in the table
+ ****************************************************************************/
+TT_RESULT tt_probe(TRANSPOSITION_TABLE *__restrict table, const uint64_t hash,
+                   const uint32_t curr_node,
+                   const uint64_t *__restrict node_words) {
+    table->stats.probes++;
+    const size_t bucket = (hash & table->bucket_mask) * TT_BUCKET_SIZE;
+
+    for (size_t slot = bucket; slot < bucket + TT_BUCKET_SIZE; slot++) {
+        const TT_ENTRY &entry = table->entries[slot];
+        if (entry.result == TT_RESULT::EMPTY || entry.hash != hash) {
+            continue;
+        }
+        if (tt_key_matches(*table, slot, curr_node, node_words)) [[likely]] {
+            table->stats.hits++;
+            return entry.result;
+        }
+        table->stats.collisions++;
+    }
+
+    table->stats.misses++;
+    return TT_RESULT::EMPTY;
+}
+
+/****************************************************************************
+ * tt_store
+ *
+ * - Records a solved position in the table, following the replacement policy
+ * described above
+ *
+ * Parameters :
+ * - table : the table to store in
+ * - hash : the position's Zobrist hash
+ * - curr_node : the position's current node
+ * - node_words : the position's packed node use list
+ * - result : the position's result (WIN or LOSS)
+ * - work : how many positions were visited to find the result
+ *
+ * Returns :
+ * - none
+ ****************************************************************************/
+void tt_store(TRANSPOSITION_TABLE *__restrict table, const uint64_t hash,
+              const uint32_t curr_node,
+              const uint64_t *__restrict node_words,
+              const TT_RESULT result, const uint64_t work) {
+    const uint32_t entry_work = work > UINT32_MAX ? UINT32_MAX : (uint32_t)work;
+    if (entry_work < table->min_store_work) {
+        return;
+    }
+
+    const size_t bucket = (hash & table->bucket_mask) * TT_BUCKET_SIZE;
+    const size_t words = table->words_per_key;
+    size_t target = bucket + 1; // "always replace" slot by default
+
+    for (size_t slot = bucket; slot < bucket + TT_BUCKET_SIZE; slot++) {
+        if (table->entries[slot].result != TT_RESULT::EMPTY &&
+            table->entries[slot].hash == hash &&
+            tt_key_matches(*table, slot, curr_node, node_words)) {
+            // already have this position, just keep the larger work value
+            table->entries[slot].work =
+                std::max(table->entries[slot].work, entry_work);
+            return;
+        }
+    }
+
+    if (table->entries[bucket].result == TT_RESULT::EMPTY ||
+        entry_work >= table->entries[bucket].work) {
+        target = bucket;
+        if (table->entries[bucket].result != TT_RESULT::EMPTY) {
+            // demote the old work preferred entry to the always replace slot
+            if (table->entries[bucket + 1].result != TT_RESULT::EMPTY) {
+                table->stats.overwrites++;
+            }
+            table->entries[bucket + 1] = table->entries[bucket];
+            std::memcpy(&table->key_words[(bucket + 1) * words],
+                        &table->key_words[bucket * words], words * 8);
+        }
+    } else if (table->entries[target].result != TT_RESULT::EMPTY) {
+        table->stats.overwrites++;
+    }
+
+    table->entries[target].hash = hash;
+    table->entries[target].work = entry_work;
+    table->entries[target].curr_node = curr_node;
+    table->entries[target].result = result;
+    std::memcpy(&table->key_words[target * words], node_words, words * 8);
+    table->stats.stores++;
+}